@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace Utility
+{
+    constexpr std::size_t allocation_sites_amount = 64;
+
+    // Heap allocations counter, per call site. Built with "TTT_TRACK_ALLOCATIONS" the global "operator new" is replaced
+    // and every allocation is charged to the innermost "AllocationSite" of the calling thread ("other" out of them).
+    // Without the flag nothing is replaced and every counter stays at 0.
+    class AllocationTracker
+    {
+    public:
+        static bool IsEnabled();
+
+        // Counters of the calling thread.
+        static std::uint64_t GetAllocationsAmount();
+        static void Reset();
+
+        // Prometheus text format: "<name>{site="..."} <allocations>", one line per site.
+        static void AppendReport(std::string& report, const std::string& name);
+
+    };
+
+    // Scope guard: the allocations made while it's alive are charged to "site" (a string literal, compared by address).
+    class AllocationSite
+    {
+    public:
+        AllocationSite(const char* site);
+        ~AllocationSite();
+
+        AllocationSite(const AllocationSite&) = delete;
+        AllocationSite& operator=(const AllocationSite&) = delete;
+
+    private:
+        const char* previous_site;
+
+    };
+}
+
+using AllocationTracker = Utility::AllocationTracker;
+using AllocationSite = Utility::AllocationSite;
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Utility
+{
+    // Process-wide clock service: the monotonic clock is read once per server tick ("Update") and every subsystem
+    // reads the cached value, in milliseconds. Wall-clock jumps can't affect it.
+    // With the virtual time the OS clock is never read: time moves only with "Advance" (simulations, replays).
+    class Clock
+    {
+    public:
+        static std::uint64_t Update();
+        static std::uint64_t GetNowMilliseconds();
+
+        static void EnableVirtualTime(const std::uint64_t start_milliseconds);
+        static void DisableVirtualTime();
+        static void Advance(const std::uint64_t milliseconds);
+        static bool IsVirtualTime();
+
+    private:
+        // Coarse (tick based) clock where available: a few milliseconds of resolution, without a syscall on Linux.
+        static std::uint64_t ReadMonotonicMilliseconds();
+
+        static std::uint64_t now_milliseconds;
+        static bool virtual_time;
+
+    };
+}
+
+using Clock = Utility::Clock;
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <array>
+
+namespace TTTServer
+{
+    constexpr std::size_t sketch_rows                 = 4;
+    constexpr std::size_t sketch_columns              = 2048; // Power of two.
+    constexpr std::size_t top_talkers_amount          = 16;
+    constexpr std::uint64_t heavy_hitters_window_ms   = 1000;
+    constexpr std::uint32_t heavy_hitters_prefix_factor = 8; // A /24 may send this many times the packets of a single address.
+
+    // Packets per source over a sliding window, in fixed memory (no state per source, which is what a flood would exhaust):
+    // a count-min sketch per window (an estimate is never below the true count) where the previous window weighs as much
+    // as it still overlaps the sliding one, and the top talkers into a min-heap.
+    // Every packet is counted twice: for its IPv4 address and for its /24 prefix.
+    class HeavyHitters
+    {
+    public:
+        HeavyHitters();
+
+        // Packets per window (per second) above which a source is dropped: 0 --> never (only counted).
+        void SetThreshold(const std::uint32_t address_threshold);
+
+        // Counts a packet from "address" (host byte order). False when the address or its /24 is above the threshold.
+        bool Record(const std::uint32_t address, const std::uint64_t now_ms);
+
+        // Moves the windows to "now_ms" without counting anything (before a report of a quiet server).
+        void Expire(const std::uint64_t now_ms);
+
+        std::uint64_t GetDropsAmount() const;
+
+        // Prometheus text format: "<name>{source="a.b.c.d"} <packets>" (or "prefix="a.b.c.0/24""), the biggest first.
+        void AppendTo(std::string& report, const std::string& name) const;
+
+    private:
+        typedef struct talker_t
+        {
+            std::uint64_t key; // Host byte order address, or the /24 prefix with bit 32 set.
+            std::uint32_t packets;
+        } talker_t;
+
+        typedef std::array<std::uint32_t, sketch_rows * sketch_columns> sketch_t;
+
+        std::array<sketch_t, 2> windows = { }; // The current one and the previous one, alternating.
+        std::size_t current_window = 0;
+        std::uint64_t window_start_ms = 0;
+        std::uint64_t now_ms = 0;
+        std::array<std::uint64_t, sketch_rows> seeds;
+
+        std::array<talker_t, top_talkers_amount> top_talkers;
+        std::size_t top_talkers_size = 0;
+
+        std::uint32_t address_threshold = 0;
+        std::uint64_t drops_amount = 0;
+
+        std::size_t GetColumn(const std::size_t row, const std::uint64_t key) const;
+        std::uint32_t Estimate(const std::uint64_t key) const;
+        void Add(const std::uint64_t key);
+        void UpdateTopTalkers(const std::uint64_t key, const std::uint32_t packets);
+        void Rotate(const std::uint64_t now_ms);
+
+    };
+}
+
+using HeavyHitters = TTTServer::HeavyHitters;
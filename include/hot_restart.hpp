@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace TTTServer
+{
+    // The handoff happens in two steps, so that only the second one pauses the game loop:
+    // 1) old --> new: | snapshot length (8) | + the UDP socket as "SCM_RIGHTS" ancillary data, then the snapshot bytes.
+    //    The old process keeps serving while the new one loads the snapshot, and records the changes made meanwhile.
+    // 2) new --> old: one byte (ready). old --> new: | delta length (8) | paused_at_ns (8) | delta bytes. new --> old: one byte (ack).
+    constexpr std::size_t handoff_state_head_size = 8;
+    constexpr std::size_t handoff_delta_head_size = 16;
+    constexpr int handoff_ack_timeout_ms          = 5000;
+
+    // Zero-downtime restart: the running server hands its bound UDP socket and its state to a new process
+    // over a Unix domain socket. POSIX only: on Windows every call fails.
+    class HotRestart
+    {
+    public:
+        ~HotRestart();
+
+        // Old process side.
+        bool Listen(const std::string& path);
+        int AcceptPending() const; // -1 when no new process is waiting.
+        bool SendState(const int connection, const int socket_id, const std::string& snapshot) const;
+        bool IsReady(const int connection) const; // Never blocks.
+        bool SendDelta(const int connection, const std::string& delta, const std::uint64_t paused_at_ns) const;
+        void Close();
+        static void CloseConnection(const int connection);
+
+        // New process side: "ReceiveState" returns the connection (-1 on failure) to use with "ReceiveDelta", and sets
+        // "socket_id" only on success.
+        static int ReceiveState(const std::string& path, int& socket_id, std::string& snapshot);
+        static bool ReceiveDelta(const int connection, std::string& delta, std::uint64_t& paused_at_ns);
+
+        // "steady_clock" is the same monotonic clock for every process on the machine.
+        static std::uint64_t GetMonotonicNanoseconds();
+
+    private:
+        int listen_fd = -1;
+        std::string path;
+
+    };
+}
+
+using HotRestart = TTTServer::HotRestart;
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <array>
+
+namespace TTTServer
+{
+    constexpr std::size_t histogram_buckets_amount = 40; // Power of two buckets: up to ~2^40 units.
+
+    // Fixed-size log2 histogram: "Record" is O(1) and never allocates, so it can sit on the hot path.
+    class Histogram
+    {
+    public:
+        void Record(const std::uint64_t value);
+        void Reset();
+
+        std::uint64_t GetCount() const;
+        std::uint64_t GetSum() const;
+        std::uint64_t GetMax() const;
+
+        // Upper bound of the bucket holding the requested quantile (0.0 - 1.0).
+        std::uint64_t GetQuantile(const double quantile) const;
+
+        // Prometheus text format: count, sum, max and the main quantiles of "name".
+        void AppendTo(std::string& report, const std::string& name) const;
+
+    private:
+        std::array<std::uint64_t, histogram_buckets_amount> buckets = { };
+        std::uint64_t count = 0;
+        std::uint64_t sum = 0;
+        std::uint64_t max = 0;
+
+    };
+
+    void AppendMetric(std::string& report, const std::string& name, const std::uint64_t value);
+
+    // Metrics are exported by rewriting a whole text file (written aside and renamed).
+    bool WriteMetricsFile(const std::string& path, const std::string& report);
+}
+
+using Histogram = TTTServer::Histogram;
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <utility.hpp>
+
+#include <cstdint>
+#include <string_view>
+
+namespace TTTServer
+{
+    constexpr std::size_t packet_buffer_capacity = 64; // As the receive buffer of both the ends ("buffer_size").
+
+    // Immutable packet, encoded once and shared by reference: the seats of a room, its spectators and the retransmission
+    // slots all point to the same bytes. The blocks come from a pool that grows only while all of them are in use,
+    // so the steady state doesn't allocate. The reference count is not atomic: only the game thread builds and sends packets.
+    // "rid" is always encoded as 0 (unreliable): a reliable send stamps its sequence number into its own copy of the header.
+    class PacketBuffer
+    {
+    public:
+        PacketBuffer() { }
+        PacketBuffer(const PacketBuffer& other_packet);
+        PacketBuffer(PacketBuffer&& other_packet) noexcept;
+        PacketBuffer& operator=(const PacketBuffer& other_packet);
+        PacketBuffer& operator=(PacketBuffer&& other_packet) noexcept;
+        ~PacketBuffer();
+
+        // | header | payload |, the payload truncated to the capacity.
+        static PacketBuffer Encode(const Command command, const std::string_view payload = std::string_view());
+        // Header only packets (START_GAME, RESET_CLIENT, ...), built once and never released.
+        static const PacketBuffer& GetStatic(const Command command);
+
+        const char* GetData() const;
+        std::size_t GetSize() const;
+        Command GetCommand() const;
+        bool IsEmpty() const;
+
+        // Heap bytes of the pool (memory report).
+        static std::size_t GetMemoryUsage();
+
+    private:
+        struct block_t;
+        block_t* block = nullptr;
+
+        // Released blocks are kept for the next packets: never given back to the heap.
+        static block_t* free_blocks;
+        static std::size_t blocks_amount;
+
+        PacketBuffer(block_t* block);
+        void Release();
+
+    };
+}
+
+using PacketBuffer = TTTServer::PacketBuffer;
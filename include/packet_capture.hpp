@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <fstream>
+#include <chrono>
+
+namespace TTTServer
+{
+    // Capture file layout (little endian):
+    // | magic (8 bytes) | header | record | record | ...
+    // header --> | clock start ms (8) | random seed (8) | session token key (16) | join cookies (1) | join cookie key (16) |
+    // record --> | timestamp_ns (8) | ipv4 address (4, network order) | port (2) | length (2) | payload (length) |
+    constexpr char capture_magic[]                 = "TTTCAP02";
+    constexpr std::size_t capture_magic_size       = 8;
+    constexpr std::size_t capture_header_size      = 49;
+    constexpr std::size_t capture_record_head_size = 16;
+    constexpr std::size_t capture_flush_interval   = 256; // Records. The server is usually stopped by killing it.
+
+    // What the recording server derived its tokens, cookies and draws from: a replay runs the same checks with them.
+    typedef struct capture_header_t
+    {
+        std::uint64_t start_milliseconds = 0; // "Clock" time of the first record.
+        std::uint64_t random_seed = 0;
+        std::uint64_t session_token_key[2] = { 0, 0 };
+        bool join_cookies = false;
+        std::uint64_t join_cookie_key[2] = { 0, 0 };
+    } capture_header_t;
+
+    typedef struct capture_record_t
+    {
+        std::uint64_t timestamp_ns; // Monotonic, relative to the start of the capture.
+        std::uint32_t address;      // Network byte order, as in "sockaddr_in::sin_addr".
+        std::uint16_t port;         // Host byte order.
+        std::uint16_t length;
+    } capture_record_t;
+
+    // Appends every inbound datagram to a binary capture file.
+    class PacketCapture
+    {
+    public:
+        PacketCapture(const std::string& path, const capture_header_t& header);
+        ~PacketCapture();
+
+        void Record(const char* buffer, const int len, const std::uint32_t address, const std::uint16_t port);
+        void Flush();
+        std::size_t GetRecordsAmount() const;
+
+    private:
+        std::ofstream file;
+        std::chrono::steady_clock::time_point start_time;
+        std::size_t records_amount = 0;
+
+    };
+
+    // Reads back, one at a time, the records written by "PacketCapture".
+    class PacketReplay
+    {
+    public:
+        PacketReplay(const std::string& path);
+
+        const capture_header_t& GetHeader() const;
+
+        // Returns false at the end of the capture (or on a truncated record).
+        bool Next(capture_record_t& record, char* buffer, const std::size_t buffer_capacity);
+
+    private:
+        std::ifstream file;
+        capture_header_t header;
+
+    };
+}
+
+using PacketCapture = TTTServer::PacketCapture;
+using PacketReplay = TTTServer::PacketReplay;
@@ -2,32 +2,78 @@
 
 #include <string>
 #include <cstdint>
+#include <vector>
+#include <array>
+#include <map>
+#include <string_view>
 
 namespace TTTGame
 {
+    constexpr std::size_t player_name_bytes_amount = 20; // Same size of the JOIN name field: names are stored inline, '\0' padded.
+
+    typedef std::array<char, player_name_bytes_amount> player_name_t;
+
+    // Dense player IDs (0 --> no player), assigned at JOIN and reused after the removal, and the index of the names.
+    // One per server: the names live inline in the "Player" of each session, the index only holds views into them.
+    class PlayerRegistry
+    {
+    public:
+        std::uint32_t Acquire();
+        // Recovery path: the ID comes from the journal.
+        void Acquire(const std::uint32_t player_id);
+        void Release(const std::uint32_t player_id);
+
+        // "player_name" must stay valid and unchanged until "RemoveName" (the name stored in the session).
+        void AddName(const std::string_view player_name, const std::uint32_t player_id);
+        void RemoveName(const std::string_view player_name, const std::uint32_t player_id);
+
+        // 0 if nobody has this name, or if more than one player has it ("ambiguous").
+        std::uint32_t FindByName(const std::string_view player_name, bool& ambiguous) const;
+        // Appends up to "max_results" IDs whose name starts with "prefix", in name order. Returns the appended amount.
+        std::size_t FindByPrefix(const std::string_view prefix, std::vector<std::uint32_t>& player_ids, const std::size_t max_results) const;
+
+        // Heap bytes held by the registry (ID lists and name index).
+        std::size_t GetMemoryUsage() const;
+
+    private:
+        std::vector<bool> used = std::vector<bool>(1, false);
+        std::vector<std::uint32_t> free_ids; // May hold IDs taken back by "Acquire(player_id)": checked when popped.
+        std::multimap<std::string_view, std::uint32_t> name_index; // Ordered: serves both the exact lookups and the prefix ranges.
+
+    };
+
+    // ----------------------------------------------------------------------------------------------
+
     class Player
     {
     public:
         Player() { }
-        Player(const std::string& player_name);
+        Player(const std::uint32_t player_id, const std::string_view player_name);
+
+        std::uint32_t GetPlayerID() const;
 
         std::pair<int, bool> GetCurrentRoom() const;
         void SetCurrentRoom(std::pair<int, bool>& current_room);
 
-        const std::string& GetName() const;
+        std::string_view GetName() const;
         
+        // Milliseconds of "Clock", rebuilt from the 32 bits kept here (exact for ages below ~49 days).
         std::size_t GetLastPacketTimeStamp() const;
         void SetLastPacketTimeStamp();
 
-        bool operator==(const Player& other_player);
-        bool operator!=(const Player& other_player);
+        bool operator==(const Player& other_player) const;
+        bool operator!=(const Player& other_player) const;
 
     private:
-        std::string player_name;
-        std::pair<int, bool> current_room; // <room_id, is_owner>
-        std::size_t last_packet_timestamp;
+        // 36 bytes: a session of an idle lobby player is mostly this record (see "Server::sessions").
+        std::uint32_t player_id = 0;
+        player_name_t name = { }; // '\0' padded.
+        std::int32_t current_room_id = -1;
+        std::uint32_t last_packet_timestamp = 0; // Low 32 bits of the "Clock" milliseconds.
+        bool is_owner = true;
 
     };
 }
 
-using Player = TTTGame::Player;
\ No newline at end of file
+using Player = TTTGame::Player;
+using PlayerRegistry = TTTGame::PlayerRegistry;
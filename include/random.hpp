@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Utility
+{
+    // Per-thread xoshiro256** generator: 32 bytes of state, seeded once per thread on its first use.
+    // With "SetSeed" (before any draw) every run produces the same sequence on each thread, for deterministic simulations;
+    // otherwise every thread reads "std::random_device" exactly once.
+    class Random
+    {
+    public:
+        static void SetSeed(const std::uint64_t seed);
+        static bool GetSeed(std::uint64_t& seed); // False without "SetSeed".
+
+        static std::uint64_t Next();
+        static bool NextBool();
+        // Uniform in [0, bound), "bound" greater than 0.
+        static std::uint32_t NextBelow(const std::uint32_t bound);
+
+    private:
+        typedef struct state_t
+        {
+            bool seeded = false;
+            std::uint64_t words[4];
+        } state_t;
+
+        static state_t& GetState();
+
+    };
+}
+
+using Random = Utility::Random;
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <utility.hpp>
+#include <packet_buffer.hpp>
+
+#include <cstdint>
+#include <string>
+#include <array>
+#include <chrono>
+
+namespace TTTServer
+{
+    // Server --> Client: "rid" is the sequence number of a reliable packet ('1'..'o'), 0 for the unreliable ones.
+    // Client --> Server: "rid" acknowledges one sequence number (explicit ACK command, or piggybacked on any packet).
+    constexpr std::uint32_t reliable_sequence_space = 63;
+    constexpr std::uint32_t initial_rto_ms          = 500;
+    constexpr std::uint32_t min_rto_ms              = 100;
+    constexpr std::uint32_t max_rto_ms              = 3000;
+    constexpr std::uint32_t max_retransmissions     = 8; // Then the in-game timeout takes care of the peer.
+    constexpr std::size_t reliable_commands_amount  = 4;
+
+    // Reliability is per message class: room state changes and the session token. Lobby traffic (announces) is idempotent.
+    bool IsReliableCommand(const Command command);
+
+    typedef struct outstanding_packet_t
+    {
+        bool active = false;
+        std::uint32_t sequence = 0;
+        PacketBuffer packet; // Shared with the other recipients: the sequence number is stamped at every send.
+        std::chrono::steady_clock::time_point sent_time;
+        std::chrono::steady_clock::time_point deadline;
+        std::uint32_t retransmissions = 0;
+    } outstanding_packet_t;
+
+    // Per-peer state: at most one packet in flight per reliable command, and the RTT estimator (RFC 6298).
+    class ReliablePeer
+    {
+    public:
+        // A peer dropped while idle is created again from its "next_sequence": the client keeps its own sequence state.
+        ReliablePeer(const std::uint32_t next_sequence = 1);
+
+        // Assigns a fresh sequence number (the "rid" to send "packet" with) and keeps a reference to it until acknowledged.
+        // An older packet of the same command is superseded: only the latest room state matters.
+        std::uint32_t Track(const PacketBuffer& packet, const std::chrono::steady_clock::time_point now);
+
+        // Returns false for unknown (or already acknowledged) sequence numbers. Optionally reports the acknowledged command
+        // and its round-trip sample, -1 when the packet was retransmitted (Karn: no sample).
+        bool Acknowledge(const std::uint32_t sequence, const std::chrono::steady_clock::time_point now, Command* command = nullptr, std::int64_t* round_trip_us = nullptr);
+
+        // The packet to send again if "deadline" is still the one of "sequence" (stale timers return nullptr).
+        // Doubles the timeout of the packet, and gives up (setting "gave_up") after "max_retransmissions".
+        const PacketBuffer* Retransmit(const std::uint32_t sequence, const std::chrono::steady_clock::time_point deadline, const std::chrono::steady_clock::time_point now, bool& gave_up);
+
+        // "time_point::max()" when "sequence" is not in flight.
+        std::chrono::steady_clock::time_point GetDeadline(const std::uint32_t sequence) const;
+        std::uint32_t GetRetransmissionTimeout() const;
+
+        // Nothing in flight: the peer can be dropped (only "GetNextSequence" has to be kept).
+        bool IsIdle() const;
+        std::uint32_t GetNextSequence() const;
+
+    private:
+        std::array<outstanding_packet_t, reliable_commands_amount> outstanding; // START_GAME, UPDATE_FIELD, RESET_CLIENT, SESSION.
+        outstanding_packet_t* Find(const std::uint32_t sequence);
+        std::uint32_t next_sequence = 1;
+
+        bool has_rtt_sample = false;
+        double smoothed_rtt_ms = 0;
+        double rtt_variation_ms = 0;
+        std::uint32_t rto_ms = initial_rto_ms;
+
+    };
+}
+
+using ReliablePeer = TTTServer::ReliablePeer;
@@ -1,57 +1,69 @@
+#pragma once
+
 #include <player.hpp>
 
-#include <memory>
 #include <cstdint>
 #include <iostream>
 #include <array>
-#include <random>
 
 namespace TTTGame
 {
     constexpr std::size_t field_amount = 9;
     constexpr std::size_t field_size = field_amount / 3;
 
+    // Seats are player IDs (0 --> empty seat), the session handles of the server: no copies of "Player" and no allocation.
+    // The field keeps the symbols sent to the clients: 'X' (owner), 'O' (challenger), ' ' (empty).
     class Room
     {
     public:
         Room() { }
-        Room(const int room_id, const Player& owner);
+        Room(const int room_id, const std::uint32_t owner);
 
         void Reset(const bool remove_challenger);
         char ParseSymbol(const std::size_t cell_index) const;
         bool IsDoorOpen() const;
 
-        std::shared_ptr<Player> CheckHorizontal(const std::size_t row) const;
-        std::shared_ptr<Player> CheckVertical(const std::size_t col) const;
-        std::shared_ptr<Player> CheckDiagonalLeft() const;
-        std::shared_ptr<Player> CheckDiagonalRight() const;
-        std::shared_ptr<Player> CheckVictory() const;
+        std::uint32_t CheckHorizontal(const std::size_t row) const;
+        std::uint32_t CheckVertical(const std::size_t col) const;
+        std::uint32_t CheckDiagonalLeft() const;
+        std::uint32_t CheckDiagonalRight() const;
+        std::uint32_t CheckVictory() const;
         bool IsDraw() const;
 
-        bool Move(Player& player, const std::size_t cell_move);
+        bool Move(const Player& player, const std::size_t cell_move);
 
         int GetRoomID() const;
-        std::shared_ptr<Player> GetOwner() const;
-        std::shared_ptr<Player> GetWinner() const;
+        std::uint32_t GetOwner() const;
+        std::uint32_t GetWinner() const;
+
+        std::uint32_t GetChallenger() const;
+        void SetChallenger(const std::uint32_t challenger);
 
-        std::shared_ptr<Player> GetChallenger() const;
-        void SetChallenger(const std::shared_ptr<Player>& challenger);
+        std::uint32_t GetTurnOf() const;
 
         void SetEndedChallengeTimestamp(const std::size_t ended_challenge_timestamp);
         std::size_t GetEndedChallengeTimestamp() const;
+
+        // Compact state used by the server journal: 9 symbols as returned by "ParseSymbol" plus the symbol of "turn_of".
+        std::string GetFieldSymbols() const;
+        char GetTurnSymbol() const;
+        void Restore(const std::string& field_symbols, const char turn_symbol);
         
         bool operator==(const Room& otherRoom);
         bool operator!=(const Room& otherRoom);
 
     private:
-        int room_id;
-        std::shared_ptr<Player> owner;
-        std::shared_ptr<Player> challenger;
-        std::array<std::shared_ptr<Player>, field_amount> play_field;
-        std::shared_ptr<Player> turn_of;
-        std::shared_ptr<Player> winner;
-
-        std::size_t ended_challenge_timestamp;
+        int room_id = 0;
+        std::uint32_t owner = 0;
+        std::uint32_t challenger = 0;
+        std::uint32_t turn_of = 0;
+        std::uint32_t winner = 0;
+        std::array<char, field_amount> play_field;
+
+        std::size_t ended_challenge_timestamp = 0; // Milliseconds of "Clock".
+
+        // 'X' --> owner, 'O' --> challenger, anything else --> 0.
+        std::uint32_t GetSeat(const char symbol) const;
 
     };
 }
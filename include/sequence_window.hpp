@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+
+namespace TTTClient
+{
+    // Late retransmissions of the reliable server packets. The server numbers them with a single 1..63 counter per
+    // peer, so each sequence is unwrapped against the newest one applied, whatever its command: less than half the
+    // space ahead is newer, the rest is older. A packet is stale when its command already applied that position or a
+    // later one, so a rare command stays fresh however many updates went by in between.
+    class SequenceWindow
+    {
+    public:
+        explicit SequenceWindow(const std::uint32_t sequence_space);
+
+        bool IsStale(const std::uint32_t command, const std::uint32_t sequence); // A fresh sequence is recorded as applied.
+        void Reset(); // A new session on the server restarts from sequence 1.
+
+    private:
+        std::uint32_t sequence_space;
+        std::uint64_t newest_position; // 0 = nothing applied yet.
+        std::unordered_map<std::uint32_t, std::uint64_t> applied_positions;
+
+    };
+}
+
+using SequenceWindow = TTTClient::SequenceWindow;
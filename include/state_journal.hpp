@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+namespace TTTServer
+{
+    constexpr char journal_snapshot_magic[]          = "TTTSNP02";
+    constexpr std::size_t journal_magic_size         = 8;
+
+    // WAL record --> | payload length (4) | lsn (8) | type (1) | checksum (4) | payload |
+    constexpr std::size_t journal_record_head_size   = 17;
+    constexpr std::size_t journal_group_commit_ms    = 5;
+
+    enum JournalRecordType : std::uint8_t
+    {
+        PLAYER_UPSERT = 0, // Join, or a change of the player room.
+        PLAYER_REMOVE = 1,
+        ROOM_UPSERT   = 2, // Room created, challenge, move, reset.
+        ROOM_REMOVE   = 3,
+        PLAYER_SEQUENCE = 4 // Next reliable sequence number of a player, after every send (see "reliable_delivery.hpp").
+    };
+
+    // Append-only write-ahead log plus periodic snapshots of the server state.
+    // The game thread only appends bytes into a memory buffer: a writer thread commits them in groups,
+    // every "journal_group_commit_ms", with a single write and fsync per group.
+    class StateJournal
+    {
+    public:
+        StateJournal(const std::string& path_prefix);
+        ~StateJournal();
+
+        // Calls "apply_record" for the snapshot content first ("snapshot_loader") and then for every WAL record
+        // newer than the snapshot. Must be called before "Open".
+        void Recover(const std::function<void(const char*, const std::size_t)>& snapshot_loader, const std::function<void(const JournalRecordType, const char*, const std::size_t)>& apply_record);
+
+        void Open();
+        void Append(const JournalRecordType type, const std::string& payload);
+
+        // "snapshot" must hold at least every change up to "snapshot_lsn" (the last LSN when its build started): the newer
+        // records are kept into the WAL and replayed over it, so a snapshot can be built while the state still changes.
+        // Older records are dropped only once the snapshot is safely in place.
+        void RequestSnapshot(std::string&& snapshot, const std::uint64_t snapshot_lsn);
+
+        std::uint64_t GetLastLsn() const;
+        std::uint64_t GetRecordsSinceSnapshot() const;
+
+    private:
+        std::string wal_path;
+        std::string snapshot_path;
+
+        std::FILE* wal_file = nullptr;
+        std::uint64_t next_lsn = 1;
+        std::uint64_t records_since_snapshot = 0;
+
+        std::mutex pending_mutex;
+        std::condition_variable pending_condition;
+        std::string pending_records;
+        std::string pending_snapshot;
+        std::uint64_t pending_snapshot_lsn = 0;
+        bool has_pending_snapshot = false;
+
+        std::atomic<bool> running;
+        std::thread writer_thread;
+        void WriterLoop();
+        bool WriteSnapshot(const std::string& snapshot, const std::uint64_t snapshot_lsn);
+        void TruncateWal(const std::uint64_t snapshot_lsn);
+
+    };
+}
+
+using StateJournal = TTTServer::StateJournal;
@@ -10,13 +10,24 @@
 #endif
 
 #include <utility.hpp>
+#include <sequence_window.hpp>
+
+// Built with "TTT_HEADLESS_ONLY" the client needs neither SDL nor stb_image: only the headless mode is compiled.
+#ifndef TTT_HEADLESS_ONLY
+    #include <SDL.h>
+    #define STB_IMAGE_IMPLEMENTATION
+    #include <stb_image.h>
+#endif
 
-#include <SDL.h>
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb_image.h>
 #include <iostream>
+#include <cstring>
+#include <cctype>
+#include <stdexcept>
+#include <fstream>
+#include <chrono>
 #include <atomic>
 #include <thread>
+#include <mutex>
 #include <vector>
 #include <functional>
 #include <unordered_map>
@@ -46,11 +57,30 @@ namespace TTTClient
 
     // Packet Protocol: >[I][I][...]
     constexpr int buffer_size                      = 64;
-    constexpr std::size_t join_packet_size        = 22;
-    constexpr std::size_t create_room_packet_size = 2;
-    constexpr std::size_t quit_packet_size        = 2;
+    constexpr int frame_buffer_size                = 512; // A FRAME of coalesced packets ("outbound_frame_size" of the server).
+    // Every packet but JOIN carries the session token (received with "SESSION") right after the header.
+    constexpr std::size_t session_token_bytes_amount = 8;
+    // A server with JOIN cookies answers the first JOIN with a COOKIE: the JOIN is sent again with the cookie after the name.
+    constexpr std::size_t join_cookie_bytes_amount   = 8;
+    // A full server answers the JOIN with the position into its waiting room: the JOIN is sent again until admitted.
+    constexpr std::size_t waiting_room_retry_seconds = 2;
+
+    constexpr std::size_t player_name_bytes_amount = 20;
+    constexpr std::size_t join_packet_size        = 2 + player_name_bytes_amount;
+    constexpr std::size_t create_room_packet_size = 2 + session_token_bytes_amount;
+    constexpr std::size_t quit_packet_size        = 2 + session_token_bytes_amount;
+    constexpr std::size_t quick_match_packet_size = 2 + session_token_bytes_amount;
     constexpr std::size_t header_bytes_amount     = 2;
     constexpr std::size_t room_id_len             = 2;
+    constexpr std::size_t move_packet_size        = 3 + session_token_bytes_amount;
+    constexpr std::size_t ack_packet_size         = 2 + session_token_bytes_amount;
+    constexpr std::size_t ping_packet_size        = 2 + session_token_bytes_amount;
+
+    // Used until the first PONG tells the interval chosen by the server.
+    constexpr std::uint32_t default_heartbeat_interval_seconds = 5;
+
+    // Sequence numbers of the reliable server packets live into "rid": 1..63 ('1'..'o'), 0 = unreliable.
+    constexpr std::uint32_t reliable_sequence_space = 63;
 
     // 0 -----> Blocked Grid
     // 1 -----> Play Grid
@@ -65,6 +95,7 @@ namespace TTTClient
         Command command;
     } header_t;
 
+#ifndef TTT_HEADLESS_ONLY
     class NaiveSDLTexture
     {
     public:
@@ -80,18 +111,24 @@ namespace TTTClient
         SDL_Rect texture_box;
 
     };
+#endif
 
     class Client
     {
     public:
-        Client(const char* ipAddress = "127.0.0.1", const int port = 9999);
+        // With "headless" set, SDL is never initialized: commands are read from "script_path" (or stdin when it is null)
+        // and every server event is written to stdout as a "key=value" line, so the client can be driven by other programs.
+        Client(const char* ipAddress = "127.0.0.1", const int port = 9999, const bool headless = false, const char* script_path = nullptr);
         ~Client();
 
         void Run();
+        void RunHeadless();
 
+#ifndef TTT_HEADLESS_ONLY
         void InitSprites();
 
         int ClickedOnWhichCell(SDL_Event* event);
+#endif
 
         void ReceiveData();
         void SendData();
@@ -100,30 +137,80 @@ namespace TTTClient
         int socket_id;
         sockaddr_in sin;
 
+        // One server packet: a FRAME is unpacked and every packet in it goes through here again, in order.
+        void HandlePacket(char* buffer, const int len);
+
         std::unordered_map<Command, std::function<void(const int)>> command_functions_snd;
         void JoinCommand(const int current_command_id);
         void CreateRoomCommand(const int current_command_id);
         void ChallengeCommand(const int current_command_id);
         void QuitCommand(const int current_command_id);
+        void MoveCommand(const int current_command_id);
+        void QuickMatchCommand(const int current_command_id);
+        void SpectateCommand(const int current_command_id);
+        void ChallengePlayerCommand(const int current_command_id);
 
         std::unordered_map<Command, std::function<void(char*, const int)>> command_functions_rcv;
         void StartGameCommand(char* buffer, const int len);
         void AnnounceRoomCommand(char* buffer, const int len);
         void UpdateFieldCommand(char* buffer, const int len);
         void ResetClientCommand(char* buffer, const int len);
+        void PongCommand(char* buffer, const int len);
+        void SessionCommand(char* buffer, const int len);
+        void CookieCommand(char* buffer, const int len);
+        void WaitingRoomCommand(char* buffer, const int len);
+
+        // The last JOIN sent ("SendData" thread), to send again with the cookie ("ReceiveData" thread)
+        // or from the waiting room ("Heartbeat" thread).
+        std::string join_info;
+        std::mutex join_mutex;
+        std::atomic<bool> in_waiting_room;
+
+        // 0 until the server answers the JOIN.
+        std::atomic<std::uint64_t> session_token;
+        std::string EncodeHeader(const std::uint32_t rid, const std::uint32_t command) const;
 
         std::thread recv_thread;
         std::thread send_thread;
-
-        SDL_Window* window;
-        SDL_Renderer* renderer;
+        std::thread heartbeat_thread;
+
+        // PINGs are sent only after the JOIN (the server ignores unknown senders).
+        std::atomic<std::uint32_t> heartbeat_interval_seconds;
+        void Heartbeat();
+
+        bool headless;
+        std::ifstream script_file;
+        std::istream* input;
+
+        // Connect-to-first-update latency: the JOIN send time is stored as "steady_clock" ticks (0 = not sent yet).
+        std::atomic<std::int64_t> join_sent_ticks;
+        std::atomic<bool> first_update_received;
+        void ReportFirstUpdateLatency();
+
+        // Reliable delivery: every sequenced packet is acknowledged at once (the last one also rides on the moves),
+        // and "SequenceWindow" tells the late retransmissions apart.
+        std::atomic<std::uint32_t> last_received_sequence;
+        SequenceWindow sequence_window; // Only touched by "ReceiveData".
+        std::atomic<bool> sequences_reset;
+        void Acknowledge(const std::uint32_t sequence);
+        bool IsStaleSequence(const Command command, const std::uint32_t sequence);
+
+#ifndef TTT_HEADLESS_ONLY
+        SDL_Window* window = nullptr;
+        SDL_Renderer* renderer = nullptr;
         std::map<TextureAsset, SDL_Texture*> textures;
         std::vector<NaiveSDLTexture> sprites;
+#endif
 
         void PrintCommands() const;
 
+        std::mutex output_mutex;
+        void EmitEvent(const std::string& event_info);
+
     };
 }
 
 using Client = TTTClient::Client;
-using NaiveSDLTexture = TTTClient::NaiveSDLTexture;
\ No newline at end of file
+#ifndef TTT_HEADLESS_ONLY
+using NaiveSDLTexture = TTTClient::NaiveSDLTexture;
+#endif
\ No newline at end of file
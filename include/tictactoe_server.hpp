@@ -5,20 +5,37 @@
     #include <ws2tcpip.h>
 #else
     #include <sys/socket.h>
+    #include <sys/select.h>
     #include <netinet/in.h>
     #include <arpa/inet.h>
 #endif
 
 #include <utility.hpp>
+#include <clock.hpp>
+#include <random.hpp>
 #include <room.hpp>
+#include <packet_capture.hpp>
+#include <state_journal.hpp>
+#include <hot_restart.hpp>
+#include <metrics.hpp>
+#include <reliable_delivery.hpp>
+#include <packet_buffer.hpp>
+#include <allocation_tracker.hpp>
+#include <heavy_hitters.hpp>
 
 #include <iostream>
 #include <cstdint>
+#include <cstring>
 #include <string>
 #include <vector>
 #include <functional>
 #include <unordered_map>
 #include <set>
+#include <deque>
+#include <queue>
+#include <array>
+#include <memory>
+#include <chrono>
 
 using Player = TTTGame::Player;
 using Room = TTTGame::Room;
@@ -29,14 +46,62 @@ namespace TTTServer
     constexpr std::size_t in_game_timeout_seconds  = 30;
 
     constexpr std::size_t header_bytes_amount      = 2; // 2 bytes interpreted as 16 bits.
-    constexpr std::size_t player_name_bytes_amount = 20;
+    constexpr std::size_t player_name_bytes_amount = TTTGame::player_name_bytes_amount;
     constexpr std::size_t cell_bytes_amount        = 1;
+    constexpr std::size_t session_token_bytes_amount = 8; // After the header of every packet but JOIN.
+    constexpr std::size_t join_cookie_bytes_amount   = 8; // After the name of a JOIN (see "Server::EnableJoinCookies").
+    constexpr std::size_t join_cookie_slot_seconds   = 10; // A cookie is valid in its time slot and in the next one.
 
     constexpr std::size_t room_id_len              = 2;
     constexpr int buffer_size                      = 64;
 
+    // Kernel buffers of the socket: what an untuned Linux grants ("net.core.rmem_max"), about 1500 queued datagrams.
+    constexpr int default_socket_buffer_bytes      = 212992;
+    constexpr int busy_poll_microseconds           = 50; // "SO_BUSY_POLL" budget of a receive (see "Server::EnableBusyPoll").
+
     constexpr std::size_t reset_field_time         = 2;
 
+    constexpr std::size_t quick_match_buckets        = 10; // Rating buckets: one digit after the QUICK_MATCH header.
+    constexpr std::size_t metrics_interval_seconds   = 10;
+
+    constexpr std::size_t spectator_batch_size       = 64;   // Datagrams handed to the kernel with a single call.
+    constexpr std::size_t spectator_sends_per_tick   = 1024; // Fan-out budget between two reads of the socket.
+
+    constexpr std::size_t outbound_frame_size        = 512; // Budget of a coalesced datagram: well below the MTU (see "Command::FRAME").
+    constexpr std::size_t outbound_message_max_size  = 255; // Length prefix of one byte: longer packets are sent alone.
+
+    // Priority lanes (see "Server::Tick"): a tick reads up to "receive_batch_size" datagrams, serves all the ones from
+    // players in a room and then at most "lobby_datagrams_per_tick" of the others. The rest of the lobby traffic waits
+    // into its lane, dropped when the lane is full.
+    constexpr std::size_t receive_batch_size         = 64;
+    constexpr std::size_t lobby_datagrams_per_tick   = 16;
+    constexpr std::size_t lobby_lane_capacity        = 1024;
+    constexpr std::size_t announce_max_deferral_ms   = 1000; // Room announces held back while overloaded, at most this long.
+
+    // Admission control (see "Server::SetCapacity"): JOINs past the players limit wait into the waiting room, sending
+    // the JOIN again every "waiting_room_retry_seconds" (the client does); a waiter that stops is dropped after the timeout.
+    constexpr std::size_t waiting_room_capacity        = 4096;
+    constexpr std::size_t waiting_room_retry_seconds   = 2;
+    constexpr std::size_t waiting_room_timeout_seconds = 5 * waiting_room_retry_seconds;
+    constexpr std::int64_t tick_work_smoothing         = 8; // Weight of the old value into the moving average of the tick work.
+
+    // Capacities reserved at startup, so that the steady state (games in progress) doesn't allocate.
+    constexpr std::size_t pending_broadcasts_capacity    = 1024;
+    constexpr std::size_t retransmission_timers_capacity = 65536;
+    constexpr std::size_t outbound_frames_capacity       = 1024;
+
+    // Heartbeats: the interval grows with the players, so that the PINGs stay within the budget,
+    // but it's never long enough to let an in-game player time out after a couple of lost PINGs.
+    constexpr std::size_t heartbeats_per_second_budget   = 20000;
+    constexpr std::size_t min_heartbeat_interval_seconds = 2;
+    constexpr std::size_t max_heartbeat_interval_seconds = in_game_timeout_seconds / 3;
+
+    constexpr std::size_t session_memory_budget_bytes = 192; // Per idle lobby player (see "tests/session_memory_test.cpp").
+
+    constexpr std::size_t snapshot_interval_seconds  = 60;
+    constexpr std::size_t snapshot_records_threshold = 1000000; // WAL records that force an earlier snapshot.
+    constexpr std::size_t snapshot_slots_per_tick    = 4096;    // Session slots copied into the periodic snapshot per tick.
+
     // ----------------------------------------------------------------------------------------------
 
     typedef struct header_t
@@ -59,8 +124,12 @@ namespace TTTServer
         class Sender
         {
         public:
+            // Formatted on demand (logs): the endpoint is kept packed.
             std::string GetIpAddress() const;
             void SetIpAddress(const std::string& ip_address);
+
+            std::uint32_t GetAddress() const; // IPv4, network byte order (as "in_addr").
+            void SetAddress(const std::uint32_t address);
             
             int GetPort() const;
             void SetterPort(const int port);
@@ -69,24 +138,25 @@ namespace TTTServer
             void operator()() { }
 
         private:
-            std::string ip_address;
-            int port;
-
-            std::size_t packets_per_second;
+            std::uint32_t address = 0;
+            std::uint16_t port = 0;
         };
 
         // Struct that use the "function call operator" to hash all the fields into "Sender" class.
         // All of this in order to use it into "std::unordered_map" as a key.
         struct SenderHash 
         {
-            size_t operator()(const Sender& sender) const 
+            // "noexcept" and cheap: the nodes don't need to cache the hash.
+            size_t operator()(const Sender& sender) const noexcept
             {
-                // Very simple hashing algorithm.
-                return std::hash<std::string>{}(sender.GetIpAddress()) + std::hash<int>{}(sender.GetPort());
+                // Address and port in one word, spread by a multiplicative hash.
+                const std::uint64_t endpoint = (static_cast<std::uint64_t>(sender.GetAddress()) << 16) | static_cast<std::uint16_t>(sender.GetPort());
+                return static_cast<size_t>((endpoint * 0x9E3779B97F4A7C15ull) >> 16);
             }
         };
         
-        Server(const char* ip_address = "127.0.0.1", const int port = 9999, const std::uint32_t timeout = 1000);
+        // With "open_socket" set to false no socket is created at all (e.g. to replay a capture offline).
+        Server(const char* ip_address = "127.0.0.1", const int port = 9999, const std::uint32_t timeout = 1000, const bool open_socket = true);
 
         void Kick(const Sender& sender);
         void DestroyRoom(const Room& room);
@@ -99,14 +169,330 @@ namespace TTTServer
 
         void Run();
 
-        void StartGame(const Room& room) const;
-        void UpdateField(const Room& room) const;
-        void ResetClient(const Room& room) const;
+        // Every inbound datagram is appended to "path" (see "packet_capture.hpp").
+        void StartCapture(const std::string& path);
+        // Feeds a capture through the dispatch path, as fast as possible or respecting the recorded timings.
+        void Replay(const std::string& path, const bool at_recorded_speed);
+
+        // Restores the state saved into "<path_prefix>.snapshot" and "<path_prefix>.wal", then keeps journaling into them.
+        void EnableJournal(const std::string& path_prefix, const bool recover = true);
+
+        // Hot restart: "EnableHotRestart" lets a future process take over from this one through "path",
+        // "TakeOver" (on a server built without socket) receives the UDP socket and the state from the running one.
+        void EnableHotRestart(const std::string& path);
+        bool TakeOver(const std::string& path);
+
+        // Two-step JOIN: a JOIN without a valid cookie only gets a COOKIE back, a keyed hash of the endpoint and of the time
+        // slot; the session is created when a JOIN echoes it. Spoofed or flooding sources never reach the server state.
+        void EnableJoinCookies();
+
+        // Flood defense: the datagrams of an address sending more than "packets_per_second" (or of a /24 sending more than
+        // "heavy_hitters_prefix_factor" times that) are dropped as they leave the socket. Counted anyway, for the metrics.
+        void EnableFloodDefense(const std::uint32_t packets_per_second);
+
+        // Capacity limits (0 --> none): a JOIN past "max_players" gets its place into the waiting room instead of a session,
+        // a new room past "max_rooms" is refused. Past "shed_latency_ms" of average work per tick the server sheds the non
+        // essential work (room announces, most of the lobby share, new admissions) until the average halves.
+        void SetCapacity(const std::size_t max_players, const std::size_t max_rooms, const std::size_t shed_latency_ms);
+
+        // Sizes the kernel buffers of the socket and reads back what the kernel granted: false (and a warning) when it's less.
+        bool SetSocketBuffers(const int receive_bytes, const int send_bytes);
+
+        // Low latency mode (tournaments): the game thread is pinned to "cpu" and spins on the socket instead of sleeping
+        // into the receive timeout, with "SO_BUSY_POLL" where allowed. It burns a whole core: the default loop is the power
+        // friendly one. To enable right before "Run", as the threads created later would inherit the pinning.
+        bool EnableBusyPoll(const int cpu);
+
+        // Rewrites "path" every "metrics_interval_seconds" with the server metrics (Prometheus text format).
+        void EnableMetrics(const std::string& path);
+
+        // Memory accounting: heap bytes of the per-session structures ("ttt_memory_bytes{structure=...}"). Returns the total.
+        std::size_t AppendMemoryReport(std::string& report) const;
+
+        void StartGame(const Room& room);
+        void UpdateField(const Room& room);
+        void ResetClient(const Room& room);
 
     private:
-        int socket_id;
+#ifdef TTT_TESTS
+        friend class ServerTest; // White-box tests (see "tests/").
+#endif
+
+        int socket_id = -1;
         sockaddr_in sin;
-        std::unordered_map<Sender, Player, SenderHash> players;
+
+        // Player IDs are the session handles (see "Room"): "sessions" is the pool of the session records, indexed by ID
+        // (a free slot has player ID 0), and "players" only maps an endpoint to its ID.
+        // "std::deque" grows at the back without moving the records, so a "session_t*" stays valid until the release.
+        // The name index of "player_registry" views the names stored in "sessions": a slot is indexed while it's in use.
+        typedef std::pair<Sender, Player> session_t;
+        std::deque<session_t> sessions;
+        PlayerRegistry player_registry;
+        session_t* AddPlayer(const Sender& sender, const Player& player);
+        void RemoveSession(const std::uint32_t player_id);
+        session_t* GetSession(const std::uint32_t player_id);
+        session_t* FindSession(const Sender& sender);
+
+        // Session token --> | player_id (24 bits) | generation of the slot (8 bits) | unpredictable salt (32 bits) |
+        // "Dispatch" resolves it with an index and a compare, then checks the endpoint: a valid token from a new endpoint
+        // (e.g. a NAT rebinding) moves the session there, instead of being an unknown player.
+        std::vector<std::uint64_t> session_tokens;
+        std::vector<std::uint8_t> session_generations;
+        std::uint64_t session_token_key[2] = { 0, 0 }; // SipHash key of the salts (see "IssueSessionToken").
+        std::uint64_t session_tokens_issued = 0;
+        session_t* dispatched_session = nullptr;
+        std::size_t rebinds_amount = 0;
+        std::uint64_t IssueSessionToken(const std::uint32_t player_id);
+        bool ResolveSession(char* buffer, int& len, const Sender& sender);
+        bool RebindSession(session_t*& session, const Sender& sender);
+        Player* FindPlayer(const Sender& sender);
+
+        // Stateless: one SipHash (see "utility.hpp") to issue a cookie, one to check it.
+        // Cookie --> | time slot (low 8 bits) | MAC of endpoint and time slot (56 bits) |
+        bool join_cookies = false;
+        std::uint64_t join_cookie_key[2] = { 0, 0 };
+        std::size_t join_cookies_amount = 0;
+        std::uint64_t ComputeJoinCookie(const Sender& sender, const std::uint64_t slot) const;
+        bool CheckJoinCookie(const char* cookie, const Sender& sender) const;
+        void SendJoinCookie(const Sender& sender);
+        // Room packets are encoded once (see "packet_buffer.hpp"): reliable to the two seats, then fanned out to the spectators.
+        void Broadcast(const Room& room, const PacketBuffer& packet);
+        void PrintTurn(const Room& room);
+
+        void Dispatch(char* buffer, int len, const sockaddr_in& sender_input);
+        int SendPacket(const char* packet, const int packet_len, const Sender& sender);
+        int SendPacket(const PacketBuffer& packet, const std::uint32_t sequence, const Sender& sender); // "rid" --> "sequence".
+        int SendDatagram(const char* packet, const int packet_len, const Sender& sender) const;
+        std::uint32_t receive_timeout_ms;
+
+        // Granted by the kernel (see "SetSocketBuffers"), and the datagrams it dropped because the receive buffer was full:
+        // a counter of the socket, carried by the "SO_RXQ_OVFL" ancillary data of every receive (Linux only).
+        int receive_buffer_bytes = 0;
+        int send_buffer_bytes = 0;
+        std::uint32_t kernel_drops_amount = 0;
+
+        // Latency of every received datagram, split in three: the time spent into the socket queue, from the kernel receive
+        // timestamp ("SO_TIMESTAMPNS", Linux only) to the read, the wait into its lane, and the service time, from the dispatch
+        // to the end of the tick, when the replies leave. Wall clock nanoseconds, as the kernel timestamps.
+        std::array<std::uint64_t, receive_batch_size + lobby_datagrams_per_tick> dispatch_timestamps_ns;
+        std::size_t dispatched_amount = 0;
+        Histogram receive_queueing_delay_us;
+        Histogram service_time_us;
+
+        // Priority lanes: the datagrams read by a tick, classified by endpoint. Rings allocated at startup: the game lane
+        // is emptied by every tick (as large as a read batch), the lobby lane keeps what exceeds its share.
+        typedef struct received_datagram_t
+        {
+            sockaddr_in sender_input;
+            std::uint64_t read_timestamp_ns;
+            int len;
+            std::array<char, buffer_size> data;
+        } received_datagram_t;
+
+        typedef struct lane_t
+        {
+            std::vector<received_datagram_t> slots;
+            std::size_t head = 0;
+            std::size_t size = 0;
+            std::size_t drops_amount = 0;
+            Histogram depth; // Datagrams waiting when the tick starts serving the lane.
+            Histogram wait_us;
+        } lane_t;
+
+        lane_t game_lane;
+        lane_t lobby_lane;
+        bool overloaded = false; // A full read batch (more is waiting into the socket) or a lobby backlog.
+        int ReceiveDatagram(received_datagram_t& datagram, const bool wait);
+        bool IsInGame(const sockaddr_in& sender_input); // The endpoint is the one of a player in a room.
+        void ServeLane(lane_t& lane, const std::size_t budget);
+
+        // Room announces fan out to every lobby player: while overloaded they're deferred and coalesced into one fan-out
+        // of the latest opened rooms, sent when the load drops (or after "announce_max_deferral_ms").
+        bool announces_deferred = false;
+        std::uint64_t announces_deferred_since_ms = 0;
+        std::size_t deferred_announces_amount = 0;
+        void SendAnnounces();
+        void DeferAnnounces();
+        void FlushDeferredAnnounces();
+
+        // Waiting room: a FIFO of tickets, as the quick match one. An entry is valid while its ticket matches the one in
+        // "waiting_tickets" and its JOINs keep coming: the position is the distance from the front.
+        typedef struct waiting_ticket_t
+        {
+            std::uint64_t ticket;
+            std::uint64_t last_join_ms;
+        } waiting_ticket_t;
+
+        typedef struct waiting_entry_t
+        {
+            Sender sender;
+            std::uint64_t ticket;
+        } waiting_entry_t;
+
+        std::size_t max_players = 0;
+        std::size_t max_rooms = 0;
+        std::deque<waiting_entry_t> waiting_room;
+        std::unordered_map<Sender, waiting_ticket_t, SenderHash> waiting_tickets;
+        std::uint64_t next_waiting_ticket = 1;
+        std::size_t admissions_amount = 0;
+        std::size_t rejected_rooms_amount = 0;
+        bool AdmitPlayer(const Sender& sender);
+        void SendWaitingRoomPosition(const std::uint64_t position, const Sender& sender);
+        bool IsRoomLimitReached(const Sender& sender);
+
+        // Load shedding: moving average of the work of a tick, from the end of the reads to the end of the sends.
+        std::int64_t shed_latency_us = 0; // 0 --> never.
+        std::uint64_t tick_start_ns = 0;
+        std::int64_t tick_work_average_us = 0;
+        Histogram tick_work_us;
+        bool shedding = false;
+        std::size_t shed_episodes_amount = 0;
+        void CheckShedding(const std::uint64_t tick_end_ns);
+
+        // Packets per source address and /24 (see "heavy_hitters.hpp"), checked before "Dispatch" looks up the sender.
+        HeavyHitters heavy_hitters;
+
+        bool busy_poll = false;
+        Histogram move_round_trip_us; // RTT samples of the acknowledged UPDATE_FIELD packets, in both the loop modes.
+
+        // Forgets every per-sender state kept outside "players" (queues, spectators, reliable delivery).
+        void ReleaseSender(const Sender& sender);
+
+        std::unique_ptr<PacketCapture> capture;
+        bool replaying = false;
+
+        std::unique_ptr<StateJournal> journal;
+        std::size_t last_snapshot_timestamp = 0;
+        void JournalPlayer(const Sender& sender, const Player& player);
+        void JournalPlayerRemoval(const Sender& sender);
+        void JournalRoom(const Room& room);
+        void JournalRoomRemoval(const int room_id);
+        void JournalReliableSequence(const Sender& sender, const std::uint32_t next_sequence);
+        bool IsJournaling() const;
+        void Journal(const JournalRecordType type, const std::string& payload);
+        void ApplyJournalRecord(const JournalRecordType type, const char* payload, const std::size_t payload_length);
+        void LoadSnapshot(const char* snapshot, const std::size_t snapshot_length);
+
+        // A periodic snapshot is copied a slice of session slots per tick (each room along with its owner): the WAL
+        // records appended meanwhile are newer than "lsn" and bring the slots already copied up to date on recovery.
+        typedef struct snapshot_build_t
+        {
+            bool active = false;
+            std::uint64_t lsn = 0;
+            std::size_t next_slot = 0;
+            std::size_t players_amount = 0;
+            std::size_t rooms_amount = 0;
+            std::string players;
+            std::string rooms;
+        } snapshot_build_t;
+
+        snapshot_build_t snapshot_build;
+        bool BuildSnapshotSlice(snapshot_build_t& build, const std::size_t slots_amount) const; // True once every slot is copied.
+        std::string FinishSnapshot(snapshot_build_t& build) const;
+        std::string BuildSnapshot() const; // The whole state at once (startup and hot restart).
+        void CheckSnapshot();
+        std::string journal_path;
+
+        bool running = true;
+        HotRestart hot_restart;
+        int handoff_connection = -1;
+        std::string handoff_delta; // Journal records produced while the new process loads the snapshot.
+        void CheckHandoff();
+        void ApplyHandoffDelta(const std::string& delta);
+
+        // Quick match: one FIFO per rating bucket. An entry is still valid only while its ticket matches
+        // the one in "quick_match_tickets", so leaving the queue is a single erase.
+        typedef struct quick_match_entry_t
+        {
+            Sender sender;
+            std::uint64_t ticket;
+            std::chrono::steady_clock::time_point enqueue_time;
+        } quick_match_entry_t;
+
+        std::array<std::deque<quick_match_entry_t>, quick_match_buckets> quick_match_queues;
+        std::unordered_map<Sender, std::uint64_t, SenderHash> quick_match_tickets;
+        std::uint64_t next_quick_match_ticket = 1;
+        Histogram time_to_match_us;
+        void LeaveQuickMatch(const Sender& sender);
+
+        // Spectators stay in the lobby (no "current_room") and are tracked only here, per room.
+        // Room packets are encoded once and fanned out in batches, after the two players have been served.
+        typedef struct spectator_t
+        {
+            Sender sender;
+            sockaddr_in address;
+        } spectator_t;
+
+        // The entry holds a reference to the packet sent to the seats: a broadcast neither copies nor allocates.
+        typedef struct spectator_broadcast_t
+        {
+            int room_id;
+            PacketBuffer packet;
+            std::size_t next_index;
+        } spectator_broadcast_t;
+
+        std::unordered_map<int, std::vector<spectator_t>> spectators;
+        std::unordered_map<Sender, std::pair<int, std::size_t>, SenderHash> spectating; // <room_id, index into "spectators">
+        std::vector<spectator_broadcast_t> pending_spectator_broadcasts; // A few entries at a time, oldest first: searched linearly.
+        spectator_broadcast_t* FindLastSpectatorBroadcast(const int room_id);
+        void LeaveSpectating(const Sender& sender);
+        void DetachSpectators(const int room_id);
+        void BroadcastToSpectators(const int room_id, const PacketBuffer& packet);
+        void FlushSpectatorBroadcasts();
+        std::size_t SendBatch(const char* packet, const int packet_len, const spectator_t* recipients, const std::size_t recipients_amount) const;
+
+        // Reliable delivery (see "reliable_delivery.hpp"): a min-heap of timers, one per transmission.
+        // Acknowledged or superseded packets leave their timer into the heap: it is discarded when it expires.
+        typedef struct retransmission_timer_t
+        {
+            std::chrono::steady_clock::time_point deadline;
+            Sender sender;
+            std::uint32_t sequence;
+
+            bool operator>(const retransmission_timer_t& other_timer) const { return deadline > other_timer.deadline; }
+        } retransmission_timer_t;
+
+        // Idle lobby players don't keep a peer: only its next sequence number, per player ID.
+        std::unordered_map<Sender, ReliablePeer, SenderHash> reliable_peers;
+        std::vector<std::uint8_t> reliable_sequences;
+        void ReleaseIdlePeer(const Sender& sender);
+        std::uint32_t GetReliableSequence(const session_t& session) const; // The next one, in flight or kept while idle.
+        void RestoreReliableSequence(const std::uint32_t player_id, const std::uint32_t next_sequence);
+        std::priority_queue<retransmission_timer_t, std::vector<retransmission_timer_t>, std::greater<retransmission_timer_t>> retransmission_timers;
+        std::size_t retransmissions_amount = 0;
+        std::size_t acknowledgements_amount = 0;
+        std::size_t give_ups_amount = 0;
+        void SendReliable(const PacketBuffer& packet, const Sender& sender);
+        void CheckRetransmissions();
+        int GetReceiveWait() const;
+
+        // Outbound coalescing: the packets a session receives during a tick are packed into a single FRAME datagram,
+        // sent at the end of the tick (a lone packet still goes out as is). Spectator fan-outs are already batched apart.
+        // "outbound_slots" maps a player ID to its frame of the tick (index + 1, 0 --> none).
+        typedef struct outbound_frame_t
+        {
+            Sender sender;
+            std::uint32_t player_id;
+            std::size_t messages_amount;
+            std::size_t size;
+            std::array<char, outbound_frame_size> data; // | FRAME header | length | packet | length | packet | ...
+        } outbound_frame_t;
+
+        std::vector<outbound_frame_t> outbound_frames;
+        std::vector<std::uint32_t> outbound_slots;
+        std::size_t outbound_datagrams_amount = 0;
+        std::size_t outbound_messages_amount = 0;
+        bool QueueOutbound(const char* packet, const int packet_len, const Sender& sender);
+        void SendFrame(outbound_frame_t& frame);
+        void FlushOutbound();
+
+        Histogram allocations_per_tick; // Filled only with "TTT_TRACK_ALLOCATIONS" (see "allocation_tracker.hpp").
+
+        std::string metrics_path;
+        std::size_t last_metrics_timestamp = 0;
+        void CheckMetrics();
+        void AppendMetrics(std::string& report) const;
+        std::unordered_map<Sender, std::uint32_t, SenderHash> players; // Endpoint --> player ID (see "sessions").
         
         std::size_t room_counter = 100;
         std::unordered_map<int, Room> rooms;
@@ -118,6 +504,17 @@ namespace TTTServer
         void ChallengeCommand(char* buffer, Sender& sender, const int len);
         void MoveCommand(char* buffer, Sender& sender, const int len);
         void QuitCommand(char* buffer, Sender& sender, const int len);
+        void QuickMatchCommand(char* buffer, Sender& sender, const int len);
+        void SpectateCommand(char* buffer, Sender& sender, const int len);
+        void AckCommand(char* buffer, Sender& sender, const int len);
+        void PingCommand(char* buffer, Sender& sender, const int len);
+        void ChallengePlayerCommand(char* buffer, Sender& sender, const int len);
+
+        // Shared tail of "ChallengeCommand" and "ChallengePlayerCommand": the room is open and the player is in the lobby.
+        void EnterRoom(Room& room, const Sender& sender, Player& player);
+
+        std::size_t GetHeartbeatInterval() const;
+        std::size_t pings_amount = 0;
 
         void SendAnnounce(const Sender& sender);
 
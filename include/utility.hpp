@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <cstdint>
 #include <chrono>
 #include <stdexcept>
 
@@ -8,11 +9,27 @@ namespace Utility
 {
     constexpr std::size_t two_figures_factor = 10;
 
-    std::size_t GetNowTime();
-
     // Handle multiple bytes if the number of figures about the "room_id" is greater than 9 (as 10).
     std::string GetParsedRoomIDLength(const std::string& room_id_str, const std::size_t room_id_len);
 
+    // Inverse of the encoding above: | header | room_id length (room_id_len bytes, '?' padded) | room_id |. Returns -1 if malformed.
+    int ParseRoomID(const char* buffer, const int len, const std::size_t header_bytes_amount, const std::size_t room_id_len);
+
+    // Two ASCII bytes, as every packet header: also valid for the commands greater than 9.
+    std::string EncodeHeader(const std::uint32_t rid, const std::uint32_t command);
+
+    // Fixed little endian encoding for the binary files written by the server (captures, journal, snapshots).
+    void WriteLittleEndian(char* destination, std::uint64_t value, const std::size_t bytes_amount);
+    void AppendLittleEndian(std::string& destination, const std::uint64_t value, const std::size_t bytes_amount);
+    std::uint64_t ReadLittleEndian(const char* source, const std::size_t bytes_amount);
+
+    // SipHash-2-4: keyed hash (MAC) of short inputs, e.g. the stateless JOIN cookies of the server.
+    std::uint64_t SipHash(const std::uint64_t key_0, const std::uint64_t key_1, const char* data, const std::size_t len);
+
+    // Memory accounting: bytes taken from the heap by a "requested_bytes" allocation
+    // (typical malloc: a size header, 16 bytes granularity, 32 bytes at least).
+    std::size_t GetHeapBlockBytes(const std::size_t requested_bytes);
+
     class NetworkException : public std::runtime_error
     {
     public:
@@ -41,7 +58,25 @@ namespace Utility
         ANNOUNCE_ROOM = 5,
         START_GAME = 6,
         UPDATE_FIELD = 7,
-        RESET_CLIENT = 8
+        RESET_CLIENT = 8,
+
+        // Client --> Server
+        QUICK_MATCH = 9,
+        SPECTATE = 10,
+        ACK = 11, // "rid" is the acknowledged sequence number (see "reliable_delivery.hpp").
+        PING = 12, // Header only: refreshes the liveness of the player.
+
+        // Server --> Client
+        PONG = 13, // Payload: heartbeat interval in seconds, as decimal digits.
+        SESSION = 14, // Payload: the session token (8 bytes, little endian) to put after the header of every next packet.
+
+        // Client --> Server
+        CHALLENGE_PLAYER = 15, // Payload: the name of the room owner (up to 20 bytes, '\0' padding allowed).
+
+        // Server --> Client
+        FRAME = 16, // Payload: several packets coalesced into one datagram, each one as | length (1 byte) | packet |.
+        COOKIE = 17, // Payload: 8 bytes to echo after the name of a new JOIN (servers with JOIN cookies only).
+        WAITING_ROOM = 18 // Payload: position into the waiting room (decimal digits, 0 --> full): the JOIN is to send again.
     };
 }
 
@@ -0,0 +1,135 @@
+#include <allocation_tracker.hpp>
+
+#include <cstdlib>
+#include <new>
+
+namespace Utility
+{
+    typedef struct allocation_site_t
+    {
+        const char* site;
+        std::uint64_t allocations_amount;
+    } allocation_site_t;
+
+    // Plain thread locals (constant initialized): "operator new" can touch them at any time, also while a thread starts.
+    static thread_local const char* current_site = nullptr;
+    static thread_local allocation_site_t sites[allocation_sites_amount];
+    static thread_local std::uint64_t allocations_amount = 0;
+
+    // ----------------------------------------------------------------------------------------------
+
+    bool AllocationTracker::IsEnabled()
+    {
+#ifdef TTT_TRACK_ALLOCATIONS
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    std::uint64_t AllocationTracker::GetAllocationsAmount()
+    {
+        return allocations_amount;
+    }
+
+    void AllocationTracker::Reset()
+    {
+        for (allocation_site_t& allocation_site : sites) allocation_site = { nullptr, 0 };
+        allocations_amount = 0;
+    }
+
+    void AllocationTracker::AppendReport(std::string& report, const std::string& name)
+    {
+        // Copied first: the report itself allocates.
+        allocation_site_t sites_copy[allocation_sites_amount];
+        for (std::size_t i = 0; i < allocation_sites_amount; i++) sites_copy[i] = sites[i];
+
+        for (const allocation_site_t& allocation_site : sites_copy)
+        {
+            if (!allocation_site.site) break;
+
+            report.append(name);
+            report.append("{site=\"");
+            report.append(allocation_site.site);
+            report.append("\"} ");
+            report.append(std::to_string(allocation_site.allocations_amount));
+            report.push_back('\n');
+        }
+    }
+
+    // ----------------------------------------------------------------------------------------------
+
+    AllocationSite::AllocationSite(const char* site) : previous_site(current_site)
+    {
+        current_site = site;
+    }
+
+    AllocationSite::~AllocationSite()
+    {
+        current_site = this->previous_site;
+    }
+
+    // ----------------------------------------------------------------------------------------------
+
+#ifdef TTT_TRACK_ALLOCATIONS
+    static void CountAllocation()
+    {
+        allocations_amount++;
+
+        const char* site = current_site ? current_site : "other";
+        for (allocation_site_t& allocation_site : sites)
+        {
+            if (allocation_site.site == site || !allocation_site.site)
+            {
+                allocation_site.site = site;
+                allocation_site.allocations_amount++;
+                return;
+            }
+        }
+
+        // Table full: the allocation is still in the total.
+    }
+
+    static void* Allocate(const std::size_t size)
+    {
+        CountAllocation();
+        return std::malloc(size ? size : 1);
+    }
+#endif
+}
+
+#ifdef TTT_TRACK_ALLOCATIONS
+// Replacements of the global allocation functions (the aligned ones are left to the standard library).
+void* operator new(std::size_t size)
+{
+    void* memory = Utility::Allocate(size);
+    if (!memory) throw std::bad_alloc();
+
+    return memory;
+}
+
+void* operator new[](std::size_t size)
+{
+    void* memory = Utility::Allocate(size);
+    if (!memory) throw std::bad_alloc();
+
+    return memory;
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    return Utility::Allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return Utility::Allocate(size);
+}
+
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete[](void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, std::size_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, std::size_t) noexcept { std::free(memory); }
+void operator delete(void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+void operator delete[](void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+#endif
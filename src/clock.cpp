@@ -0,0 +1,67 @@
+#include <clock.hpp>
+
+#ifdef _WIN32
+    #include <Windows.h>
+#else
+    #include <time.h>
+#endif
+
+#include <chrono>
+
+namespace Utility
+{
+    std::uint64_t Clock::now_milliseconds = Clock::ReadMonotonicMilliseconds();
+    bool Clock::virtual_time = false;
+
+    // ----------------------------------------------------------------------------------------------
+
+    std::uint64_t Clock::Update()
+    {
+        if (!virtual_time) now_milliseconds = ReadMonotonicMilliseconds();
+        return now_milliseconds;
+    }
+
+    std::uint64_t Clock::GetNowMilliseconds()
+    {
+        return now_milliseconds;
+    }
+
+    // ----------------------------------------------------------------------------------------------
+
+    void Clock::EnableVirtualTime(const std::uint64_t start_milliseconds)
+    {
+        virtual_time = true;
+        now_milliseconds = start_milliseconds;
+    }
+
+    void Clock::DisableVirtualTime()
+    {
+        virtual_time = false;
+        Update();
+    }
+
+    void Clock::Advance(const std::uint64_t milliseconds)
+    {
+        if (virtual_time) now_milliseconds += milliseconds;
+    }
+
+    bool Clock::IsVirtualTime()
+    {
+        return virtual_time;
+    }
+
+    // ----------------------------------------------------------------------------------------------
+
+    std::uint64_t Clock::ReadMonotonicMilliseconds()
+    {
+#if defined(_WIN32)
+        return GetTickCount64();
+#elif defined(CLOCK_MONOTONIC_COARSE)
+        timespec now;
+        clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+        return static_cast<std::uint64_t>(now.tv_sec) * 1000 + now.tv_nsec / 1000000;
+#else
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+}
@@ -0,0 +1,203 @@
+#include <heavy_hitters.hpp>
+
+#include <algorithm>
+#include <random>
+
+namespace TTTServer
+{
+    constexpr std::uint64_t prefix_key_flag = std::uint64_t(1) << 32;
+    constexpr std::uint32_t prefix_mask = 0xFFFFFF00;
+
+    // Min-heap order: the smallest talker on the front, the first one to leave.
+    static bool IsBiggerTalker(const std::uint32_t packets, const std::uint32_t other_packets)
+    {
+        return packets > other_packets;
+    }
+
+    static void AppendAddress(std::string& report, const std::uint32_t address)
+    {
+        for (int shift = 24; shift >= 0; shift -= 8)
+        {
+            report.append(std::to_string((address >> shift) & 0xFF));
+            if (shift > 0) report.push_back('.');
+        }
+    }
+
+    // ----------------------------------------------------------------------------------------------
+
+    HeavyHitters::HeavyHitters()
+    {
+        // Never from the seeded generator ("--seed"): known hashes would let a flood pick the counters of a victim.
+        std::random_device random_device;
+        for (std::uint64_t& seed : this->seeds)
+        {
+            seed = (static_cast<std::uint64_t>(random_device()) << 32) | random_device();
+        }
+    }
+
+    void HeavyHitters::SetThreshold(const std::uint32_t address_threshold)
+    {
+        this->address_threshold = address_threshold;
+    }
+
+    void HeavyHitters::Expire(const std::uint64_t now_ms)
+    {
+        this->Rotate(now_ms);
+    }
+
+    std::uint64_t HeavyHitters::GetDropsAmount() const
+    {
+        return this->drops_amount;
+    }
+
+    bool HeavyHitters::Record(const std::uint32_t address, const std::uint64_t now_ms)
+    {
+        this->Rotate(now_ms);
+
+        const std::uint64_t address_key = address;
+        const std::uint64_t prefix_key = prefix_key_flag | (address & prefix_mask);
+
+        // Also the dropped packets are counted: a flood stays above the threshold for as long as it lasts.
+        this->Add(address_key);
+        this->Add(prefix_key);
+
+        const std::uint32_t address_packets = this->Estimate(address_key);
+        const std::uint32_t prefix_packets = this->Estimate(prefix_key);
+        this->UpdateTopTalkers(address_key, address_packets);
+        this->UpdateTopTalkers(prefix_key, prefix_packets);
+
+        if (this->address_threshold == 0) return true;
+        if (address_packets <= this->address_threshold && prefix_packets <= this->address_threshold * heavy_hitters_prefix_factor) return true;
+
+        this->drops_amount++;
+        return false;
+    }
+
+    // ----------------------------------------------------------------------------------------------
+
+    std::size_t HeavyHitters::GetColumn(const std::size_t row, const std::uint64_t key) const
+    {
+        std::uint64_t hash = (key ^ this->seeds[row]) * 0x9E3779B97F4A7C15ull;
+        hash ^= hash >> 32;
+
+        return row * sketch_columns + (hash & (sketch_columns - 1));
+    }
+
+    // Conservative update: only the smallest counters grow, the others already overestimate the key.
+    void HeavyHitters::Add(const std::uint64_t key)
+    {
+        sketch_t& sketch = this->windows[this->current_window];
+
+        std::uint32_t packets = UINT32_MAX;
+        for (std::size_t row = 0; row < sketch_rows; row++) packets = std::min(packets, sketch[this->GetColumn(row, key)]);
+        if (packets == UINT32_MAX) return;
+
+        packets++;
+        for (std::size_t row = 0; row < sketch_rows; row++)
+        {
+            std::uint32_t& counter = sketch[this->GetColumn(row, key)];
+            if (counter < packets) counter = packets;
+        }
+    }
+
+    // Sliding window: the whole current window plus the part of the previous one still inside the last "heavy_hitters_window_ms".
+    std::uint32_t HeavyHitters::Estimate(const std::uint64_t key) const
+    {
+        const sketch_t& current_sketch = this->windows[this->current_window];
+        const sketch_t& previous_sketch = this->windows[this->current_window ^ 1];
+
+        std::uint32_t current_packets = UINT32_MAX, previous_packets = UINT32_MAX;
+        for (std::size_t row = 0; row < sketch_rows; row++)
+        {
+            const std::size_t column = this->GetColumn(row, key);
+            current_packets = std::min(current_packets, current_sketch[column]);
+            previous_packets = std::min(previous_packets, previous_sketch[column]);
+        }
+
+        const std::uint64_t elapsed_ms = std::min(this->now_ms - this->window_start_ms, heavy_hitters_window_ms);
+        const std::uint64_t weighted_packets = previous_packets * (heavy_hitters_window_ms - elapsed_ms) / heavy_hitters_window_ms;
+
+        return static_cast<std::uint32_t>(std::min<std::uint64_t>(current_packets + weighted_packets, UINT32_MAX));
+    }
+
+    void HeavyHitters::UpdateTopTalkers(const std::uint64_t key, const std::uint32_t packets)
+    {
+        auto is_bigger = [](const talker_t& talker, const talker_t& other_talker) { return IsBiggerTalker(talker.packets, other_talker.packets); };
+        talker_t* const begin = this->top_talkers.data();
+
+        for (std::size_t i = 0; i < this->top_talkers_size; i++)
+        {
+            if (this->top_talkers[i].key != key) continue;
+
+            this->top_talkers[i].packets = packets;
+            std::make_heap(begin, begin + this->top_talkers_size, is_bigger);
+            return;
+        }
+
+        if (this->top_talkers_size < top_talkers_amount)
+        {
+            this->top_talkers[this->top_talkers_size++] = { key, packets };
+            std::push_heap(begin, begin + this->top_talkers_size, is_bigger);
+            return;
+        }
+
+        if (!IsBiggerTalker(packets, this->top_talkers.front().packets)) return;
+
+        std::pop_heap(begin, begin + this->top_talkers_size, is_bigger);
+        this->top_talkers[this->top_talkers_size - 1] = { key, packets };
+        std::push_heap(begin, begin + this->top_talkers_size, is_bigger);
+    }
+
+    void HeavyHitters::Rotate(const std::uint64_t now_ms)
+    {
+        this->now_ms = now_ms;
+        if (now_ms - this->window_start_ms < heavy_hitters_window_ms) return;
+
+        if (now_ms - this->window_start_ms >= 2 * heavy_hitters_window_ms)
+        {
+            // Silent for more than a window: nothing of the previous one is left either.
+            this->windows[this->current_window].fill(0);
+            this->window_start_ms = now_ms;
+        }
+        else
+        {
+            this->window_start_ms += heavy_hitters_window_ms;
+        }
+
+        this->current_window ^= 1;
+        this->windows[this->current_window].fill(0);
+
+        // The talkers keep their place with the sliding estimate: the ones gone quiet leave the heap.
+        std::size_t kept_amount = 0;
+        for (std::size_t i = 0; i < this->top_talkers_size; i++)
+        {
+            const std::uint32_t packets = this->Estimate(this->top_talkers[i].key);
+            if (packets > 0) this->top_talkers[kept_amount++] = { this->top_talkers[i].key, packets };
+        }
+
+        this->top_talkers_size = kept_amount;
+        std::make_heap(this->top_talkers.data(), this->top_talkers.data() + kept_amount,
+            [](const talker_t& talker, const talker_t& other_talker) { return IsBiggerTalker(talker.packets, other_talker.packets); });
+    }
+
+    // ----------------------------------------------------------------------------------------------
+
+    void HeavyHitters::AppendTo(std::string& report, const std::string& name) const
+    {
+        std::array<talker_t, top_talkers_amount> talkers = this->top_talkers;
+        std::sort(talkers.begin(), talkers.begin() + this->top_talkers_size,
+            [](const talker_t& talker, const talker_t& other_talker) { return IsBiggerTalker(talker.packets, other_talker.packets); });
+
+        for (std::size_t i = 0; i < this->top_talkers_size; i++)
+        {
+            const bool is_prefix = talkers[i].key & prefix_key_flag;
+
+            report.append(name);
+            report.append(is_prefix ? "{prefix=\"" : "{source=\"");
+            AppendAddress(report, static_cast<std::uint32_t>(talkers[i].key));
+            report.append(is_prefix ? "/24\"} " : "\"} ");
+            report.append(std::to_string(talkers[i].packets));
+            report.push_back('\n');
+        }
+    }
+}
@@ -0,0 +1,267 @@
+#include <hot_restart.hpp>
+#include <utility.hpp>
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#ifndef _WIN32
+    #include <sys/socket.h>
+    #include <sys/un.h>
+    #include <poll.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+namespace TTTServer
+{
+    HotRestart::~HotRestart()
+    {
+        this->Close();
+    }
+
+    std::uint64_t HotRestart::GetMonotonicNanoseconds()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+#ifdef _WIN32
+
+    bool HotRestart::Listen(const std::string& path)
+    {
+        std::cout << "Hot restart is not supported on this platform!\n";
+        return false;
+    }
+
+    int HotRestart::AcceptPending() const { return -1; }
+    bool HotRestart::SendState(const int connection, const int socket_id, const std::string& snapshot) const { return false; }
+    bool HotRestart::IsReady(const int connection) const { return false; }
+    bool HotRestart::SendDelta(const int connection, const std::string& delta, const std::uint64_t paused_at_ns) const { return false; }
+    void HotRestart::Close() { }
+    void HotRestart::CloseConnection(const int connection) { }
+
+    int HotRestart::ReceiveState(const std::string& path, int& socket_id, std::string& snapshot)
+    {
+        std::cout << "Hot restart is not supported on this platform!\n";
+        return -1;
+    }
+
+    bool HotRestart::ReceiveDelta(const int connection, std::string& delta, std::uint64_t& paused_at_ns) { return false; }
+
+#else
+
+    static bool FillUnixAddress(const std::string& path, sockaddr_un& address)
+    {
+        if (path.size() >= sizeof(address.sun_path)) return false;
+
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+        return true;
+    }
+
+    static bool WriteAll(const int fd, const char* bytes, std::size_t bytes_amount)
+    {
+        while (bytes_amount > 0)
+        {
+            const ssize_t written = send(fd, bytes, bytes_amount, MSG_NOSIGNAL);
+            if (written <= 0) return false;
+
+            bytes += written;
+            bytes_amount -= written;
+        }
+
+        return true;
+    }
+
+    static bool ReadAll(const int fd, char* bytes, std::size_t bytes_amount)
+    {
+        while (bytes_amount > 0)
+        {
+            const ssize_t read = recv(fd, bytes, bytes_amount, 0);
+            if (read <= 0) return false;
+
+            bytes += read;
+            bytes_amount -= read;
+        }
+
+        return true;
+    }
+
+    bool HotRestart::Listen(const std::string& path)
+    {
+        sockaddr_un address;
+        if (!FillUnixAddress(path, address)) return false;
+
+        this->listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (this->listen_fd < 0) return false;
+
+        // A previous server (already handed off, or crashed) may have left the path behind.
+        unlink(path.c_str());
+
+        if (bind(this->listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) || listen(this->listen_fd, 1))
+        {
+            this->Close();
+            return false;
+        }
+
+        // Checked once per tick by the game loop: it must never block.
+        fcntl(this->listen_fd, F_SETFL, fcntl(this->listen_fd, F_GETFL, 0) | O_NONBLOCK);
+
+        this->path = path;
+        return true;
+    }
+
+    int HotRestart::AcceptPending() const
+    {
+        if (this->listen_fd < 0) return -1;
+        return accept(this->listen_fd, nullptr, nullptr);
+    }
+
+    bool HotRestart::SendState(const int connection, const int socket_id, const std::string& snapshot) const
+    {
+        char state_head[handoff_state_head_size];
+        Utility::WriteLittleEndian(state_head, snapshot.size(), 8);
+
+        iovec head_vector = { state_head, handoff_state_head_size };
+
+        // Ancillary buffer aligned as "cmsghdr" requires.
+        union
+        {
+            char buffer[CMSG_SPACE(sizeof(int))];
+            cmsghdr align;
+        } control;
+        std::memset(&control, 0, sizeof(control));
+
+        msghdr message;
+        std::memset(&message, 0, sizeof(message));
+        message.msg_iov = &head_vector;
+        message.msg_iovlen = 1;
+        message.msg_control = control.buffer;
+        message.msg_controllen = sizeof(control.buffer);
+
+        cmsghdr* rights = CMSG_FIRSTHDR(&message);
+        rights->cmsg_level = SOL_SOCKET;
+        rights->cmsg_type = SCM_RIGHTS;
+        rights->cmsg_len = CMSG_LEN(sizeof(int));
+        std::memcpy(CMSG_DATA(rights), &socket_id, sizeof(int));
+
+        // The connection was accepted from a non-blocking listener: the transfer itself is blocking.
+        fcntl(connection, F_SETFL, fcntl(connection, F_GETFL, 0) & ~O_NONBLOCK);
+
+        if (sendmsg(connection, &message, MSG_NOSIGNAL) != static_cast<ssize_t>(handoff_state_head_size)) return false;
+        return WriteAll(connection, snapshot.data(), snapshot.size());
+    }
+
+    bool HotRestart::IsReady(const int connection) const
+    {
+        pollfd ready_poll = { connection, POLLIN, 0 };
+        if (poll(&ready_poll, 1, 0) <= 0) return false;
+
+        char ready;
+        return recv(connection, &ready, 1, 0) == 1;
+    }
+
+    bool HotRestart::SendDelta(const int connection, const std::string& delta, const std::uint64_t paused_at_ns) const
+    {
+        char delta_head[handoff_delta_head_size];
+        Utility::WriteLittleEndian(&delta_head[0], delta.size(), 8);
+        Utility::WriteLittleEndian(&delta_head[8], paused_at_ns, 8);
+
+        if (!WriteAll(connection, delta_head, handoff_delta_head_size)) return false;
+        if (!WriteAll(connection, delta.data(), delta.size())) return false;
+
+        pollfd ack_poll = { connection, POLLIN, 0 };
+        if (poll(&ack_poll, 1, handoff_ack_timeout_ms) <= 0) return false;
+
+        char ack;
+        return recv(connection, &ack, 1, 0) == 1;
+    }
+
+    void HotRestart::Close()
+    {
+        if (this->listen_fd < 0) return;
+
+        close(this->listen_fd);
+        this->listen_fd = -1;
+    }
+
+    void HotRestart::CloseConnection(const int connection)
+    {
+        if (connection >= 0) close(connection);
+    }
+
+    int HotRestart::ReceiveState(const std::string& path, int& socket_id, std::string& snapshot)
+    {
+        sockaddr_un address;
+        if (!FillUnixAddress(path, address)) return -1;
+
+        const int connection = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (connection < 0) return -1;
+
+        if (connect(connection, reinterpret_cast<sockaddr*>(&address), sizeof(address)))
+        {
+            close(connection);
+            return -1;
+        }
+
+        char state_head[handoff_state_head_size];
+        iovec head_vector = { state_head, handoff_state_head_size };
+
+        union
+        {
+            char buffer[CMSG_SPACE(sizeof(int))];
+            cmsghdr align;
+        } control;
+
+        msghdr message;
+        std::memset(&message, 0, sizeof(message));
+        message.msg_iov = &head_vector;
+        message.msg_iovlen = 1;
+        message.msg_control = control.buffer;
+        message.msg_controllen = sizeof(control.buffer);
+
+        const ssize_t received = recvmsg(connection, &message, MSG_WAITALL);
+        cmsghdr* rights = CMSG_FIRSTHDR(&message);
+
+        // Once received, the socket is already open into this process: closed on any later failure.
+        int received_socket_id = -1;
+        if (rights && rights->cmsg_level == SOL_SOCKET && rights->cmsg_type == SCM_RIGHTS) std::memcpy(&received_socket_id, CMSG_DATA(rights), sizeof(int));
+
+        if (received != static_cast<ssize_t>(handoff_state_head_size) || received_socket_id < 0)
+        {
+            if (received_socket_id >= 0) close(received_socket_id);
+            close(connection);
+            return -1;
+        }
+
+        snapshot.resize(Utility::ReadLittleEndian(state_head, 8));
+        if (!ReadAll(connection, &snapshot[0], snapshot.size()))
+        {
+            close(received_socket_id);
+            close(connection);
+            return -1;
+        }
+
+        socket_id = received_socket_id;
+        return connection;
+    }
+
+    bool HotRestart::ReceiveDelta(const int connection, std::string& delta, std::uint64_t& paused_at_ns)
+    {
+        const char ready = 1;
+        if (!WriteAll(connection, &ready, 1)) return false;
+
+        char delta_head[handoff_delta_head_size];
+        if (!ReadAll(connection, delta_head, handoff_delta_head_size)) return false;
+
+        delta.resize(Utility::ReadLittleEndian(&delta_head[0], 8));
+        paused_at_ns = Utility::ReadLittleEndian(&delta_head[8], 8);
+        if (!ReadAll(connection, &delta[0], delta.size())) return false;
+
+        const char ack = 1;
+        return WriteAll(connection, &ack, 1);
+    }
+
+#endif
+}
@@ -0,0 +1,94 @@
+#include <metrics.hpp>
+
+#include <cstdio>
+
+namespace TTTServer
+{
+    void Histogram::Record(const std::uint64_t value)
+    {
+        std::size_t bucket = 0;
+        while (bucket + 1 < histogram_buckets_amount && (std::uint64_t(1) << bucket) <= value) bucket++;
+
+        this->buckets[bucket]++;
+        this->count++;
+        this->sum += value;
+        if (value > this->max) this->max = value;
+    }
+
+    void Histogram::Reset()
+    {
+        this->buckets.fill(0);
+        this->count = 0;
+        this->sum = 0;
+        this->max = 0;
+    }
+
+    std::uint64_t Histogram::GetCount() const
+    {
+        return this->count;
+    }
+
+    std::uint64_t Histogram::GetSum() const
+    {
+        return this->sum;
+    }
+
+    std::uint64_t Histogram::GetMax() const
+    {
+        return this->max;
+    }
+
+    std::uint64_t Histogram::GetQuantile(const double quantile) const
+    {
+        if (this->count == 0) return 0;
+
+        const std::uint64_t target = static_cast<std::uint64_t>(quantile * (this->count - 1)) + 1;
+        std::uint64_t seen = 0;
+
+        for (std::size_t bucket = 0; bucket < histogram_buckets_amount; bucket++)
+        {
+            seen += this->buckets[bucket];
+            if (seen >= target)
+            {
+                const std::uint64_t upper_bound = std::uint64_t(1) << bucket;
+                return upper_bound < this->max ? upper_bound : this->max;
+            }
+        }
+
+        return this->max;
+    }
+
+    void Histogram::AppendTo(std::string& report, const std::string& name) const
+    {
+        AppendMetric(report, name + "_count", this->count);
+        AppendMetric(report, name + "_sum", this->sum);
+        AppendMetric(report, name + "_max", this->max);
+        AppendMetric(report, name + "{quantile=\"0.5\"}", this->GetQuantile(0.5));
+        AppendMetric(report, name + "{quantile=\"0.99\"}", this->GetQuantile(0.99));
+    }
+
+    // ----------------------------------------------------------------------------------------------
+
+    void AppendMetric(std::string& report, const std::string& name, const std::uint64_t value)
+    {
+        report.append(name);
+        report.push_back(' ');
+        report.append(std::to_string(value));
+        report.push_back('\n');
+    }
+
+    bool WriteMetricsFile(const std::string& path, const std::string& report)
+    {
+        const std::string temporary_path = path + ".tmp";
+        std::FILE* file = std::fopen(temporary_path.c_str(), "wb");
+        if (!file) return false;
+
+        std::fwrite(report.data(), 1, report.size(), file);
+        std::fclose(file);
+
+#ifdef _WIN32
+        std::remove(path.c_str()); // "rename" doesn't overwrite on Windows.
+#endif
+        return std::rename(temporary_path.c_str(), path.c_str()) == 0;
+    }
+}
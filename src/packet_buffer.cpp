@@ -0,0 +1,159 @@
+#include <packet_buffer.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace TTTServer
+{
+    constexpr std::size_t commands_amount = Command::WAITING_ROOM + 1; // The last command.
+    constexpr std::size_t header_size = 2;
+
+    struct PacketBuffer::block_t
+    {
+        std::array<char, packet_buffer_capacity> data;
+        std::size_t size = 0;
+        std::uint32_t references = 0;
+        bool is_static = false;
+        block_t* next_free = nullptr;
+    };
+
+    PacketBuffer::block_t* PacketBuffer::free_blocks = nullptr;
+    std::size_t PacketBuffer::blocks_amount = 0;
+
+    static void WriteHeader(char* destination, const Command command)
+    {
+        const std::string header(Utility::EncodeHeader(0, command)); // Two bytes: no allocation.
+        std::memcpy(destination, header.data(), header.size());
+    }
+
+    // ----------------------------------------------------------------------------------------------
+
+    PacketBuffer::PacketBuffer(block_t* block) : block(block)
+    {
+        this->block->references++;
+    }
+
+    PacketBuffer::PacketBuffer(const PacketBuffer& other_packet) : block(other_packet.block)
+    {
+        if (this->block) this->block->references++;
+    }
+
+    PacketBuffer::PacketBuffer(PacketBuffer&& other_packet) noexcept : block(other_packet.block)
+    {
+        other_packet.block = nullptr;
+    }
+
+    PacketBuffer& PacketBuffer::operator=(const PacketBuffer& other_packet)
+    {
+        block_t* other_block = other_packet.block; // Kept first: safe with self assignment (e.g. swap and pop).
+        if (other_block) other_block->references++;
+
+        this->Release();
+        this->block = other_block;
+
+        return *this;
+    }
+
+    PacketBuffer& PacketBuffer::operator=(PacketBuffer&& other_packet) noexcept
+    {
+        if (this != &other_packet)
+        {
+            this->Release();
+            this->block = other_packet.block;
+            other_packet.block = nullptr;
+        }
+
+        return *this;
+    }
+
+    PacketBuffer::~PacketBuffer()
+    {
+        this->Release();
+    }
+
+    void PacketBuffer::Release()
+    {
+        if (!this->block) return;
+
+        if (--this->block->references == 0 && !this->block->is_static)
+        {
+            this->block->next_free = PacketBuffer::free_blocks;
+            PacketBuffer::free_blocks = this->block;
+        }
+
+        this->block = nullptr;
+    }
+
+    // ----------------------------------------------------------------------------------------------
+
+    PacketBuffer PacketBuffer::Encode(const Command command, const std::string_view payload)
+    {
+        block_t* block = PacketBuffer::free_blocks;
+        if (block)
+        {
+            PacketBuffer::free_blocks = block->next_free;
+        }
+        else
+        {
+            block = new block_t();
+            PacketBuffer::blocks_amount++;
+        }
+
+        WriteHeader(block->data.data(), command);
+
+        const std::size_t payload_len = std::min(payload.size(), packet_buffer_capacity - header_size);
+        std::memcpy(block->data.data() + header_size, payload.data(), payload_len);
+        block->size = header_size + payload_len;
+
+        return PacketBuffer(block);
+    }
+
+    const PacketBuffer& PacketBuffer::GetStatic(const Command command)
+    {
+        static block_t static_blocks[commands_amount];
+        static const std::array<PacketBuffer, commands_amount> static_packets = []()
+        {
+            std::array<PacketBuffer, commands_amount> packets;
+            for (std::size_t i = 0; i < commands_amount; i++)
+            {
+                static_blocks[i].is_static = true;
+                WriteHeader(static_blocks[i].data.data(), static_cast<Command>(i));
+                static_blocks[i].size = header_size;
+
+                packets[i] = PacketBuffer(&static_blocks[i]);
+            }
+
+            return packets;
+        }();
+
+        return static_packets[command < commands_amount ? static_cast<std::size_t>(command) : 0];
+    }
+
+    // ----------------------------------------------------------------------------------------------
+
+    const char* PacketBuffer::GetData() const
+    {
+        return this->block ? this->block->data.data() : nullptr;
+    }
+
+    std::size_t PacketBuffer::GetSize() const
+    {
+        return this->block ? this->block->size : 0;
+    }
+
+    Command PacketBuffer::GetCommand() const
+    {
+        return this->block ? static_cast<Command>(this->block->data[1] - '0') : Command::JOIN;
+    }
+
+    bool PacketBuffer::IsEmpty() const
+    {
+        return !this->block;
+    }
+
+    std::size_t PacketBuffer::GetMemoryUsage()
+    {
+        return PacketBuffer::blocks_amount * Utility::GetHeapBlockBytes(sizeof(block_t));
+    }
+}
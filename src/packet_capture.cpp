@@ -0,0 +1,107 @@
+#include <packet_capture.hpp>
+#include <utility.hpp>
+
+#include <cstring>
+
+namespace TTTServer
+{
+    PacketCapture::PacketCapture(const std::string& path, const capture_header_t& header) : file(path, std::ios::binary | std::ios::trunc), start_time(std::chrono::steady_clock::now())
+    {
+        if (!this->file)
+        {
+            throw NetworkException("ERROR: Unable to open the capture file \"" + path + "\"!\n");
+        }
+
+        char header_bytes[capture_header_size];
+        Utility::WriteLittleEndian(&header_bytes[0], header.start_milliseconds, 8);
+        Utility::WriteLittleEndian(&header_bytes[8], header.random_seed, 8);
+        Utility::WriteLittleEndian(&header_bytes[16], header.session_token_key[0], 8);
+        Utility::WriteLittleEndian(&header_bytes[24], header.session_token_key[1], 8);
+        header_bytes[32] = header.join_cookies ? 1 : 0;
+        Utility::WriteLittleEndian(&header_bytes[33], header.join_cookie_key[0], 8);
+        Utility::WriteLittleEndian(&header_bytes[41], header.join_cookie_key[1], 8);
+
+        this->file.write(capture_magic, capture_magic_size);
+        this->file.write(header_bytes, capture_header_size);
+        this->file.flush(); // The secrets are needed by any replay, even of a capture cut short.
+    }
+
+    PacketCapture::~PacketCapture()
+    {
+        this->file.flush();
+    }
+
+    void PacketCapture::Record(const char* buffer, const int len, const std::uint32_t address, const std::uint16_t port)
+    {
+        if (len < 0) return;
+
+        const std::uint64_t timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - this->start_time).count();
+
+        char record_head[capture_record_head_size];
+        Utility::WriteLittleEndian(&record_head[0], timestamp_ns, 8);
+        std::memcpy(&record_head[8], &address, 4); // Already in network order: stored as is.
+        Utility::WriteLittleEndian(&record_head[12], port, 2);
+        Utility::WriteLittleEndian(&record_head[14], static_cast<std::uint16_t>(len), 2);
+
+        this->file.write(record_head, capture_record_head_size);
+        this->file.write(buffer, len);
+        this->records_amount++;
+
+        if (this->records_amount % capture_flush_interval == 0) this->file.flush();
+    }
+
+    void PacketCapture::Flush()
+    {
+        this->file.flush();
+    }
+
+    std::size_t PacketCapture::GetRecordsAmount() const
+    {
+        return this->records_amount;
+    }
+
+    // ----------------------------------------------------------------------------------------------
+
+    PacketReplay::PacketReplay(const std::string& path) : file(path, std::ios::binary)
+    {
+        char magic[capture_magic_size];
+        char header_bytes[capture_header_size];
+        if (!this->file || !this->file.read(magic, capture_magic_size) || std::memcmp(magic, capture_magic, capture_magic_size) != 0 || !this->file.read(header_bytes, capture_header_size))
+        {
+            throw NetworkException("ERROR: \"" + path + "\" is not a valid capture file!\n");
+        }
+
+        this->header.start_milliseconds = Utility::ReadLittleEndian(&header_bytes[0], 8);
+        this->header.random_seed = Utility::ReadLittleEndian(&header_bytes[8], 8);
+        this->header.session_token_key[0] = Utility::ReadLittleEndian(&header_bytes[16], 8);
+        this->header.session_token_key[1] = Utility::ReadLittleEndian(&header_bytes[24], 8);
+        this->header.join_cookies = header_bytes[32] != 0;
+        this->header.join_cookie_key[0] = Utility::ReadLittleEndian(&header_bytes[33], 8);
+        this->header.join_cookie_key[1] = Utility::ReadLittleEndian(&header_bytes[41], 8);
+    }
+
+    const capture_header_t& PacketReplay::GetHeader() const
+    {
+        return this->header;
+    }
+
+    bool PacketReplay::Next(capture_record_t& record, char* buffer, const std::size_t buffer_capacity)
+    {
+        char record_head[capture_record_head_size];
+        if (!this->file.read(record_head, capture_record_head_size)) return false;
+
+        record.timestamp_ns = Utility::ReadLittleEndian(&record_head[0], 8);
+        std::memcpy(&record.address, &record_head[8], 4);
+        record.port = static_cast<std::uint16_t>(Utility::ReadLittleEndian(&record_head[12], 2));
+        record.length = static_cast<std::uint16_t>(Utility::ReadLittleEndian(&record_head[14], 2));
+
+        // Payloads bigger than the receive buffer would have been truncated by "recvfrom" too.
+        const std::size_t stored_length = record.length;
+        if (record.length > buffer_capacity) record.length = static_cast<std::uint16_t>(buffer_capacity);
+
+        if (!this->file.read(buffer, record.length)) return false;
+        if (stored_length > record.length) this->file.ignore(stored_length - record.length);
+
+        return true;
+    }
+}
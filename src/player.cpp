@@ -1,50 +1,159 @@
 #include <player.hpp>
+#include <clock.hpp>
 #include <utility.hpp>
 
+#include <cstring>
+
 namespace TTTGame
 {
-    Player::Player(const std::string& player_name) : player_name(player_name), current_room { -1, true }, last_packet_timestamp(Utility::GetNowTime()) { }
+    std::uint32_t PlayerRegistry::Acquire()
+    {
+        while (!this->free_ids.empty())
+        {
+            const std::uint32_t player_id = this->free_ids.back();
+            this->free_ids.pop_back();
+            if (this->used[player_id]) continue;
+
+            this->used[player_id] = true;
+            return player_id;
+        }
+
+        this->used.push_back(true);
+        return static_cast<std::uint32_t>(this->used.size() - 1);
+    }
+
+    void PlayerRegistry::Acquire(const std::uint32_t player_id)
+    {
+        if (player_id == 0) return;
+
+        if (player_id >= this->used.size())
+        {
+            // The IDs skipped here are free.
+            for (std::uint32_t free_id = static_cast<std::uint32_t>(this->used.size()); free_id < player_id; free_id++) this->free_ids.push_back(free_id);
+            this->used.resize(player_id + 1, false);
+        }
+
+        this->used[player_id] = true;
+    }
+
+    void PlayerRegistry::Release(const std::uint32_t player_id)
+    {
+        if (player_id == 0 || player_id >= this->used.size() || !this->used[player_id]) return;
+
+        this->used[player_id] = false;
+        this->free_ids.push_back(player_id);
+    }
+
+    // ----------------------------------------------------------------------------------------------
+
+    void PlayerRegistry::AddName(const std::string_view player_name, const std::uint32_t player_id)
+    {
+        this->name_index.emplace(player_name, player_id);
+    }
+
+    void PlayerRegistry::RemoveName(const std::string_view player_name, const std::uint32_t player_id)
+    {
+        auto entries = this->name_index.equal_range(player_name);
+        for (auto entry = entries.first; entry != entries.second; ++entry)
+        {
+            if (entry->second != player_id) continue;
+
+            this->name_index.erase(entry);
+            return;
+        }
+    }
+
+    std::uint32_t PlayerRegistry::FindByName(const std::string_view player_name, bool& ambiguous) const
+    {
+        auto entry = this->name_index.find(player_name);
+        if (entry == this->name_index.end())
+        {
+            ambiguous = false;
+            return 0;
+        }
+
+        auto next_entry = std::next(entry);
+        ambiguous = next_entry != this->name_index.end() && next_entry->first == player_name;
+        return ambiguous ? 0 : entry->second;
+    }
+
+    std::size_t PlayerRegistry::FindByPrefix(const std::string_view prefix, std::vector<std::uint32_t>& player_ids, const std::size_t max_results) const
+    {
+        std::size_t found = 0;
+        for (auto entry = this->name_index.lower_bound(prefix); entry != this->name_index.end() && found < max_results; ++entry, found++)
+        {
+            if (entry->first.compare(0, prefix.size(), prefix) != 0) break;
+            player_ids.push_back(entry->second);
+        }
+
+        return found;
+    }
+
+    std::size_t PlayerRegistry::GetMemoryUsage() const
+    {
+        // A red-black tree node: color, 3 links and the entry (name view and ID).
+        const std::size_t name_index_node_bytes = Utility::GetHeapBlockBytes(4 * sizeof(void*) + sizeof(std::pair<const std::string_view, std::uint32_t>));
+
+        return this->used.capacity() / 8 + this->free_ids.capacity() * sizeof(std::uint32_t) + this->name_index.size() * name_index_node_bytes;
+    }
+
+    // ----------------------------------------------------------------------------------------------
+
+    Player::Player(const std::uint32_t player_id, const std::string_view player_name) : player_id(player_id), current_room_id(-1), last_packet_timestamp(static_cast<std::uint32_t>(Clock::GetNowMilliseconds())), is_owner(true)
+    {
+        player_name.copy(this->name.data(), this->name.size());
+    }
+
+    std::uint32_t Player::GetPlayerID() const
+    {
+        return this->player_id;
+    }
 
     // ----------------------------------------------------------------------------------------------
 
     std::pair<int, bool> Player::GetCurrentRoom() const
     {
-        return this->current_room;
+        return { this->current_room_id, this->is_owner };
     }
 
     void Player::SetCurrentRoom(std::pair<int, bool>& current_room)
     {
-        this->current_room = current_room;
+        this->current_room_id = current_room.first;
+        this->is_owner = current_room.second;
     }
 
     // ----------------------------------------------------------------------------------------------
 
-    const std::string& Player::GetName() const
+    std::string_view Player::GetName() const
     {
-        return this->player_name;
+        return std::string_view(this->name.data(), strnlen(this->name.data(), this->name.size()));
     }
 
     // ----------------------------------------------------------------------------------------------
 
     std::size_t Player::GetLastPacketTimeStamp() const
     {
-        return this->last_packet_timestamp;
+        // The age is computed on 32 bits (modular arithmetic), then taken away from the full clock.
+        const std::size_t now = Clock::GetNowMilliseconds();
+        const std::uint32_t age = static_cast<std::uint32_t>(now) - this->last_packet_timestamp;
+
+        return age <= now ? now - age : 0;
     }
 
     void Player::SetLastPacketTimeStamp()
     {
-        this->last_packet_timestamp = Utility::GetNowTime();
+        this->last_packet_timestamp = static_cast<std::uint32_t>(Clock::GetNowMilliseconds());
     }
 
     // ----------------------------------------------------------------------------------------------
     
-    bool Player::operator==(const Player& other_player)
+    bool Player::operator==(const Player& other_player) const
     {
-        return this->player_name.compare(other_player.player_name) == 0;
+        return this->player_id == other_player.player_id;
     }
 
-    bool Player::operator!=(const Player& other_player)
+    bool Player::operator!=(const Player& other_player) const
     {
         return !(*this == other_player);
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,97 @@
+#include <random.hpp>
+
+#include <random>
+#include <atomic>
+
+namespace Utility
+{
+    static std::atomic<bool> fixed_seed_set(false);
+    static std::atomic<std::uint64_t> fixed_seed(0);
+    static std::atomic<std::uint64_t> threads_amount(0);
+
+    // SplitMix64: expands one 64 bits seed into well mixed state words.
+    static std::uint64_t SplitMix64(std::uint64_t& seed)
+    {
+        std::uint64_t value = (seed += 0x9E3779B97F4A7C15ull);
+        value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+        value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+        return value ^ (value >> 31);
+    }
+
+    static std::uint64_t RotateLeft(const std::uint64_t value, const int bits)
+    {
+        return (value << bits) | (value >> (64 - bits));
+    }
+
+    // ----------------------------------------------------------------------------------------------
+
+    void Random::SetSeed(const std::uint64_t seed)
+    {
+        fixed_seed = seed;
+        fixed_seed_set = true;
+    }
+
+    bool Random::GetSeed(std::uint64_t& seed)
+    {
+        seed = fixed_seed;
+        return fixed_seed_set;
+    }
+
+    Random::state_t& Random::GetState()
+    {
+        thread_local state_t state;
+        if (state.seeded) return state;
+
+        // Same fixed seed, different stream per thread (in order of first use).
+        std::uint64_t seed;
+        if (fixed_seed_set) seed = fixed_seed + threads_amount++ * 0xD1B54A32D192ED03ull;
+        else
+        {
+            std::random_device random_device;
+            seed = (static_cast<std::uint64_t>(random_device()) << 32) | random_device();
+        }
+
+        for (std::uint64_t& word : state.words) word = SplitMix64(seed);
+        state.seeded = true;
+
+        return state;
+    }
+
+    // ----------------------------------------------------------------------------------------------
+
+    std::uint64_t Random::Next()
+    {
+        std::uint64_t* words = GetState().words;
+
+        const std::uint64_t result = RotateLeft(words[1] * 5, 7) * 9;
+        const std::uint64_t shifted = words[1] << 17;
+
+        words[2] ^= words[0];
+        words[3] ^= words[1];
+        words[1] ^= words[2];
+        words[0] ^= words[3];
+        words[2] ^= shifted;
+        words[3] = RotateLeft(words[3], 45);
+
+        return result;
+    }
+
+    bool Random::NextBool()
+    {
+        return Next() >> 63; // The high bits are the best ones.
+    }
+
+    std::uint32_t Random::NextBelow(const std::uint32_t bound)
+    {
+        // Lemire's multiply-shift with rejection: the products whose low half falls below 2^32 mod "bound" are drawn
+        // again, so every result is exactly as likely. The modulo is only computed in that (rare) case.
+        std::uint64_t product = (Next() >> 32) * bound;
+        if (static_cast<std::uint32_t>(product) < bound)
+        {
+            const std::uint32_t threshold = static_cast<std::uint32_t>(0u - bound) % bound;
+            while (static_cast<std::uint32_t>(product) < threshold) product = (Next() >> 32) * bound;
+        }
+
+        return static_cast<std::uint32_t>(product >> 32);
+    }
+}
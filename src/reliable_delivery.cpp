@@ -0,0 +1,138 @@
+#include <reliable_delivery.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace TTTServer
+{
+    bool IsReliableCommand(const Command command)
+    {
+        return command == Command::START_GAME || command == Command::UPDATE_FIELD || command == Command::RESET_CLIENT || command == Command::SESSION;
+    }
+
+    static std::size_t GetSlot(const Command command)
+    {
+        return command == Command::SESSION ? reliable_commands_amount - 1 : command - Command::START_GAME;
+    }
+
+    // ----------------------------------------------------------------------------------------------
+
+    ReliablePeer::ReliablePeer(const std::uint32_t next_sequence) : next_sequence((next_sequence == 0 || next_sequence > reliable_sequence_space) ? 1 : next_sequence) { }
+
+    std::uint32_t ReliablePeer::Track(const PacketBuffer& packet, const std::chrono::steady_clock::time_point now)
+    {
+        const std::uint32_t sequence = this->next_sequence;
+        this->next_sequence = (this->next_sequence % reliable_sequence_space) + 1; // 1..63, 0 is "unreliable".
+
+        // One slot per command: the new packet supersedes the old one.
+        outstanding_packet_t& outstanding_packet = this->outstanding[GetSlot(packet.GetCommand())];
+        outstanding_packet.active = true;
+        outstanding_packet.sequence = sequence;
+        outstanding_packet.packet = packet;
+        outstanding_packet.sent_time = now;
+        outstanding_packet.deadline = now + std::chrono::milliseconds(this->rto_ms);
+        outstanding_packet.retransmissions = 0;
+
+        return sequence;
+    }
+
+    bool ReliablePeer::Acknowledge(const std::uint32_t sequence, const std::chrono::steady_clock::time_point now, Command* command, std::int64_t* round_trip_us)
+    {
+        outstanding_packet_t* outstanding_packet = this->Find(sequence);
+        if (!outstanding_packet) return false;
+
+        if (command) *command = outstanding_packet->packet.GetCommand();
+        if (round_trip_us) *round_trip_us = -1;
+
+        outstanding_packet->active = false;
+        outstanding_packet->packet = PacketBuffer(); // Back to the pool, once the other recipients are done with it.
+
+        // Karn: an ACK of a retransmitted packet can't tell which copy it acknowledges.
+        if (outstanding_packet->retransmissions > 0) return true;
+
+        if (round_trip_us) *round_trip_us = std::chrono::duration_cast<std::chrono::microseconds>(now - outstanding_packet->sent_time).count();
+
+        const double rtt_ms = std::chrono::duration<double, std::milli>(now - outstanding_packet->sent_time).count();
+        if (!this->has_rtt_sample)
+        {
+            this->smoothed_rtt_ms = rtt_ms;
+            this->rtt_variation_ms = rtt_ms / 2;
+            this->has_rtt_sample = true;
+        }
+        else
+        {
+            this->rtt_variation_ms = 0.75 * this->rtt_variation_ms + 0.25 * std::abs(this->smoothed_rtt_ms - rtt_ms);
+            this->smoothed_rtt_ms = 0.875 * this->smoothed_rtt_ms + 0.125 * rtt_ms;
+        }
+
+        const double rto_ms = this->smoothed_rtt_ms + 4 * this->rtt_variation_ms;
+        this->rto_ms = std::clamp(static_cast<std::uint32_t>(rto_ms), min_rto_ms, max_rto_ms);
+
+        return true;
+    }
+
+    const PacketBuffer* ReliablePeer::Retransmit(const std::uint32_t sequence, const std::chrono::steady_clock::time_point deadline, const std::chrono::steady_clock::time_point now, bool& gave_up)
+    {
+        gave_up = false;
+
+        outstanding_packet_t* outstanding_packet = this->Find(sequence);
+        if (!outstanding_packet || outstanding_packet->deadline != deadline) return nullptr;
+
+        if (outstanding_packet->retransmissions >= max_retransmissions)
+        {
+            outstanding_packet->active = false;
+            outstanding_packet->packet = PacketBuffer();
+            gave_up = true;
+            return nullptr;
+        }
+
+        outstanding_packet->retransmissions++;
+
+        const std::uint32_t backoff_ms = std::min(max_rto_ms, this->rto_ms << std::min<std::uint32_t>(outstanding_packet->retransmissions, 5));
+        outstanding_packet->deadline = now + std::chrono::milliseconds(backoff_ms);
+
+        return &outstanding_packet->packet;
+    }
+
+    std::chrono::steady_clock::time_point ReliablePeer::GetDeadline(const std::uint32_t sequence) const
+    {
+        for (const outstanding_packet_t& outstanding_packet : this->outstanding)
+        {
+            if (outstanding_packet.active && outstanding_packet.sequence == sequence) return outstanding_packet.deadline;
+        }
+
+        return std::chrono::steady_clock::time_point::max();
+    }
+
+    std::uint32_t ReliablePeer::GetRetransmissionTimeout() const
+    {
+        return this->rto_ms;
+    }
+
+    bool ReliablePeer::IsIdle() const
+    {
+        for (const outstanding_packet_t& outstanding_packet : this->outstanding)
+        {
+            if (outstanding_packet.active) return false;
+        }
+
+        return true;
+    }
+
+    std::uint32_t ReliablePeer::GetNextSequence() const
+    {
+        return this->next_sequence;
+    }
+
+    outstanding_packet_t* ReliablePeer::Find(const std::uint32_t sequence)
+    {
+        if (sequence == 0 || sequence > reliable_sequence_space) return nullptr;
+
+        for (outstanding_packet_t& outstanding_packet : this->outstanding)
+        {
+            if (outstanding_packet.active && outstanding_packet.sequence == sequence) return &outstanding_packet;
+        }
+
+        return nullptr;
+    }
+}
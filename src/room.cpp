@@ -1,108 +1,87 @@
 #include <room.hpp>
+#include <random.hpp>
 
 namespace TTTGame
 {
-    Room::Room(const int room_id, const Player& owner) : room_id(room_id)
+    Room::Room(const int room_id, const std::uint32_t owner) : room_id(room_id), owner(owner)
     {
-        this->owner = std::make_shared<Player>(owner);
         this->Reset(true);
     }
 
     bool Room::IsDoorOpen() const
     {
-        return this->challenger == nullptr;
+        return this->challenger == 0;
     }
 
     void Room::Reset(const bool removeChallenger)
     {
         if (removeChallenger)
         { 
-            this->challenger = nullptr;
+            this->challenger = 0;
             this->turn_of = owner;
         }
         else
         {
-            std::random_device random_device; // RNG Hardware based
-            std::mt19937 generator(random_device()); // Mersenne Twister PRNG
-            std::uniform_int_distribution<int> distribution(0, 1); // RNG generator object
-
-            if (distribution(generator)) this->turn_of = owner;
+            // Coin flip for the first move.
+            if (Random::NextBool()) this->turn_of = owner;
             else this->turn_of = challenger;
-
-            std::cout << "Turn of \"" << this->turn_of->GetName() << "\"!\n";
         }
 
-        this->play_field.fill(nullptr);
-        this->winner = nullptr;
+        this->play_field.fill(' ');
+        this->winner = 0;
     }
 
     // ----------------------------------------------------------------------------------------------
 
     char Room::ParseSymbol(const std::size_t cell_index) const
     {
-        if (!play_field[cell_index]) return ' ';
-        if (*play_field[cell_index] == *owner) return 'X';
-        if (*play_field[cell_index] == *challenger) return 'O';
-        return '?';
+        return this->play_field[cell_index];
+    }
+
+    std::uint32_t Room::GetSeat(const char symbol) const
+    {
+        if (symbol == 'X') return this->owner;
+        if (symbol == 'O') return this->challenger;
+        return 0;
     }
     
     // ----------------------------------------------------------------------------------------------
 
-    std::shared_ptr<Player> Room::CheckHorizontal(const std::size_t row) const
+    std::uint32_t Room::CheckHorizontal(const std::size_t row) const
     {
-        for (std::size_t col = 0; col < field_size; col++)
-        {
-            if (!this->play_field[row * field_size + col]) return nullptr;
-        }
-
-        std::shared_ptr<Player> current_player = this->play_field[row * field_size];
-        if (*this->play_field[row * field_size + 1] != *current_player) return nullptr;
-        if (*this->play_field[row * field_size + 2] != *current_player) return nullptr;
-        return current_player;
+        const char symbol = this->play_field[row * field_size];
+        if (this->play_field[row * field_size + 1] != symbol) return 0;
+        if (this->play_field[row * field_size + 2] != symbol) return 0;
+        return this->GetSeat(symbol);
     }
 
-    std::shared_ptr<Player> Room::CheckVertical(const std::size_t col) const
+    std::uint32_t Room::CheckVertical(const std::size_t col) const
     {
-        for (std::size_t row = 0; row < field_size; row++)
-        {
-            if (!this->play_field[row * field_size + col]) return nullptr;
-        }
-
-        std::shared_ptr<Player> current_player = this->play_field[col /* + (0 * field_size) */ ];
-        if (*this->play_field[col + 1 * field_size] != *current_player) return nullptr;
-        if (*this->play_field[col + 2 * field_size] != *current_player) return nullptr;
-        return current_player;
+        const char symbol = this->play_field[col /* + (0 * field_size) */ ];
+        if (this->play_field[col + 1 * field_size] != symbol) return 0;
+        if (this->play_field[col + 2 * field_size] != symbol) return 0;
+        return this->GetSeat(symbol);
     }
 
-    std::shared_ptr<Player> Room::CheckDiagonalLeft() const
+    std::uint32_t Room::CheckDiagonalLeft() const
     {
-        if (!this->play_field[0]) return nullptr;
-        if (!this->play_field[4]) return nullptr;
-        if (!this->play_field[8]) return nullptr;
-
-        std::shared_ptr<Player> current_player = this->play_field[0];
-        if (*this->play_field[4] != *current_player) return nullptr;
-        if (*this->play_field[8] != *current_player) return nullptr;
-
-        return current_player;
+        const char symbol = this->play_field[0];
+        if (this->play_field[4] != symbol) return 0;
+        if (this->play_field[8] != symbol) return 0;
+        return this->GetSeat(symbol);
     }
 
-    std::shared_ptr<Player> Room::CheckDiagonalRight() const
+    std::uint32_t Room::CheckDiagonalRight() const
     {
-        if (!this->play_field[2]) return nullptr;
-        if (!this->play_field[4]) return nullptr;
-        if (!this->play_field[6]) return nullptr;
-
-        std::shared_ptr<Player> current_player = this->play_field[2];
-        if (*this->play_field[4] != *current_player) return nullptr;
-        if (*this->play_field[6] != *current_player) return nullptr;
-
-        return current_player;
+        const char symbol = this->play_field[2];
+        if (this->play_field[4] != symbol) return 0;
+        if (this->play_field[6] != symbol) return 0;
+        return this->GetSeat(symbol);
     }
 
-    std::shared_ptr<Player> Room::CheckVictory() const
+    std::uint32_t Room::CheckVictory() const
     {
-        std::shared_ptr<Player> winner_player;
+        std::uint32_t winner_player;
 
         for (std::size_t row = 0; row < field_size; row++)
         {
@@ -123,9 +102,9 @@ namespace TTTGame
 
     bool Room::IsDraw() const
     {
-        for (const std::shared_ptr<Player> cell : this->play_field)
+        for (const char cell : this->play_field)
         {
-            if (!cell) return false;
+            if (cell == ' ') return false;
         }
 
         return true;
@@ -138,25 +117,25 @@ namespace TTTGame
         return this->room_id;
     }
 
-    std::shared_ptr<Player> Room::GetOwner() const
+    std::uint32_t Room::GetOwner() const
     {
         return this->owner;
     }
 
-    bool Room::Move(Player& player, const std::size_t cell_move)
+    bool Room::Move(const Player& player, const std::size_t cell_move)
     {
         if (cell_move < 0 || cell_move > 8) return false;
-        if (this->play_field[cell_move]) return false;
+        if (this->play_field[cell_move] != ' ') return false;
         if (this->winner) return false;
         if (!this->challenger) return false;
         
         int currentRoomID = player.GetCurrentRoom().first;
 
         if (currentRoomID != this->room_id) return false;
-        if (player != *(this->owner) && player != *this->challenger) return false;
-        if (player != *this->turn_of) return false;
+        if (player.GetPlayerID() != this->owner && player.GetPlayerID() != this->challenger) return false;
+        if (player.GetPlayerID() != this->turn_of) return false;
 
-        this->play_field[cell_move] = std::make_shared<Player>(player);
+        this->play_field[cell_move] = (this->turn_of == this->owner) ? 'X' : 'O';
         this->winner = this->CheckVictory();
         this->turn_of = (this->turn_of == this->owner) ? this->challenger : this->owner; 
 
@@ -165,16 +144,21 @@ namespace TTTGame
 
     // ----------------------------------------------------------------------------------------------
 
-    std::shared_ptr<Player> Room::GetChallenger() const
+    std::uint32_t Room::GetChallenger() const
     {
         return this->challenger;
     }
 
-    void Room::SetChallenger(const std::shared_ptr<Player>& challenger)
+    void Room::SetChallenger(const std::uint32_t challenger)
     {
         this->challenger = challenger;
     }
 
+    std::uint32_t Room::GetTurnOf() const
+    {
+        return this->turn_of;
+    }
+
     // ----------------------------------------------------------------------------------------------
 
     void Room::SetEndedChallengeTimestamp(const std::size_t ended_challenge_timestamp)
@@ -189,7 +173,32 @@ namespace TTTGame
 
     // ----------------------------------------------------------------------------------------------
 
-    std::shared_ptr<Player> Room::GetWinner() const
+    std::string Room::GetFieldSymbols() const
+    {
+        return std::string(this->play_field.data(), field_amount);
+    }
+
+    char Room::GetTurnSymbol() const
+    {
+        if (!this->turn_of) return ' ';
+        return (this->challenger && this->turn_of == this->challenger) ? 'O' : 'X';
+    }
+
+    void Room::Restore(const std::string& field_symbols, const char turn_symbol)
+    {
+        for (std::size_t i = 0; i < field_amount; i++)
+        {
+            const char symbol = i < field_symbols.size() ? field_symbols[i] : ' ';
+            this->play_field[i] = (symbol == 'X' || (symbol == 'O' && this->challenger)) ? symbol : ' ';
+        }
+
+        this->turn_of = (turn_symbol == 'O' && this->challenger) ? this->challenger : this->owner;
+        this->winner = this->CheckVictory();
+    }
+
+    // ----------------------------------------------------------------------------------------------
+
+    std::uint32_t Room::GetWinner() const
     {
         return this->winner;
     }
@@ -205,4 +214,4 @@ namespace TTTGame
     {
         return !(*this == other_room);
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,36 @@
+#include <sequence_window.hpp>
+
+namespace TTTClient
+{
+    SequenceWindow::SequenceWindow(const std::uint32_t sequence_space) : sequence_space(sequence_space), newest_position(0) { }
+
+    bool SequenceWindow::IsStale(const std::uint32_t command, const std::uint32_t sequence)
+    {
+        if (sequence == 0 || sequence > this->sequence_space) return false;
+
+        // Positions keep the sequence modulo the space; the first one leaves room below for the older ones.
+        std::uint64_t position = sequence + this->sequence_space;
+        if (this->newest_position != 0)
+        {
+            const std::uint32_t newest_sequence = static_cast<std::uint32_t>(this->newest_position % this->sequence_space);
+            const std::uint32_t distance = (sequence + this->sequence_space - newest_sequence) % this->sequence_space;
+            if (distance == 0) return true;
+
+            position = distance <= this->sequence_space / 2 ? this->newest_position + distance : this->newest_position - (this->sequence_space - distance);
+        }
+
+        auto applied_position = this->applied_positions.find(command);
+        if (applied_position != this->applied_positions.end() && applied_position->second >= position) return true;
+
+        this->applied_positions[command] = position;
+        if (position > this->newest_position) this->newest_position = position;
+
+        return false;
+    }
+
+    void SequenceWindow::Reset()
+    {
+        this->newest_position = 0;
+        this->applied_positions.clear();
+    }
+}
@@ -0,0 +1,277 @@
+#include <state_journal.hpp>
+#include <utility.hpp>
+
+#include <cstring>
+#include <vector>
+#include <chrono>
+
+#ifdef _WIN32
+    #include <io.h>
+#else
+    #include <unistd.h>
+#endif
+
+namespace TTTServer
+{
+    // FNV-1a, only to detect torn or corrupted records at the tail of the WAL.
+    static std::uint32_t Checksum(const char* bytes, const std::size_t bytes_amount)
+    {
+        std::uint32_t hash = 2166136261u;
+        for (std::size_t i = 0; i < bytes_amount; i++)
+        {
+            hash = (hash ^ static_cast<unsigned char>(bytes[i])) * 16777619u;
+        }
+
+        return hash;
+    }
+
+    static void SyncFile(std::FILE* file)
+    {
+        std::fflush(file);
+#ifdef _WIN32
+        _commit(_fileno(file));
+#else
+        fsync(fileno(file));
+#endif
+    }
+
+    static bool ReadWholeFile(const std::string& path, std::vector<char>& content)
+    {
+        std::FILE* file = std::fopen(path.c_str(), "rb");
+        if (!file) return false;
+
+        std::fseek(file, 0, SEEK_END);
+        const long size = std::ftell(file);
+        std::fseek(file, 0, SEEK_SET);
+
+        content.resize(size > 0 ? size : 0);
+        const bool read = content.empty() || std::fread(content.data(), 1, content.size(), file) == content.size();
+        std::fclose(file);
+
+        return read;
+    }
+
+    // ----------------------------------------------------------------------------------------------
+
+    StateJournal::StateJournal(const std::string& path_prefix) : wal_path(path_prefix + ".wal"), snapshot_path(path_prefix + ".snapshot"), running(false) { }
+
+    StateJournal::~StateJournal()
+    {
+        if (this->running)
+        {
+            this->running = false;
+            this->pending_condition.notify_one();
+            this->writer_thread.join();
+        }
+
+        if (this->wal_file) std::fclose(this->wal_file);
+    }
+
+    void StateJournal::Recover(const std::function<void(const char*, const std::size_t)>& snapshot_loader, const std::function<void(const JournalRecordType, const char*, const std::size_t)>& apply_record)
+    {
+        std::uint64_t snapshot_lsn = 0;
+        std::vector<char> content;
+
+        // Snapshot --> | magic (8) | lsn (8) | state (handled by the server) |
+        if (ReadWholeFile(this->snapshot_path, content) && content.size() >= journal_magic_size + 8 && std::memcmp(content.data(), journal_snapshot_magic, journal_magic_size) == 0)
+        {
+            snapshot_lsn = Utility::ReadLittleEndian(&content[journal_magic_size], 8);
+            snapshot_loader(&content[journal_magic_size + 8], content.size() - journal_magic_size - 8);
+        }
+
+        this->next_lsn = snapshot_lsn + 1;
+
+        if (!ReadWholeFile(this->wal_path, content)) return;
+
+        std::size_t offset = 0;
+        while (offset + journal_record_head_size <= content.size())
+        {
+            const char* record_head = &content[offset];
+            const std::size_t payload_length = Utility::ReadLittleEndian(&record_head[0], 4);
+            const std::uint64_t lsn = Utility::ReadLittleEndian(&record_head[4], 8);
+            const JournalRecordType type = static_cast<JournalRecordType>(record_head[12]);
+            const std::uint32_t checksum = static_cast<std::uint32_t>(Utility::ReadLittleEndian(&record_head[13], 4));
+
+            if (offset + journal_record_head_size + payload_length > content.size()) break; // Torn tail.
+
+            const char* payload = &content[offset + journal_record_head_size];
+            if (Checksum(payload, payload_length) != checksum) break;
+
+            // Records already covered by the snapshot (a crash happened before the WAL was truncated).
+            if (lsn > snapshot_lsn)
+            {
+                apply_record(type, payload, payload_length);
+                this->next_lsn = lsn + 1;
+                this->records_since_snapshot++;
+            }
+
+            offset += journal_record_head_size + payload_length;
+        }
+    }
+
+    void StateJournal::Open()
+    {
+        this->wal_file = std::fopen(this->wal_path.c_str(), "ab");
+        if (!this->wal_file)
+        {
+            throw NetworkException("ERROR: Unable to open the journal \"" + this->wal_path + "\"!\n");
+        }
+
+        this->running = true;
+        this->writer_thread = std::thread(&StateJournal::WriterLoop, this);
+    }
+
+    void StateJournal::Append(const JournalRecordType type, const std::string& payload)
+    {
+        char record_head[journal_record_head_size];
+        Utility::WriteLittleEndian(&record_head[0], payload.size(), 4);
+        Utility::WriteLittleEndian(&record_head[4], this->next_lsn++, 8);
+        record_head[12] = static_cast<char>(type);
+        Utility::WriteLittleEndian(&record_head[13], Checksum(payload.data(), payload.size()), 4);
+
+        {
+            std::lock_guard<std::mutex> lock(this->pending_mutex);
+            this->pending_records.append(record_head, journal_record_head_size);
+            this->pending_records.append(payload);
+        }
+
+        this->records_since_snapshot++;
+    }
+
+    void StateJournal::RequestSnapshot(std::string&& snapshot, const std::uint64_t snapshot_lsn)
+    {
+        {
+            // Pending records are still written: the WAL is cut by the writer only after the snapshot rename.
+            std::lock_guard<std::mutex> lock(this->pending_mutex);
+            this->pending_snapshot = std::move(snapshot);
+            this->pending_snapshot_lsn = snapshot_lsn;
+            this->has_pending_snapshot = true;
+        }
+
+        this->records_since_snapshot = this->next_lsn - 1 - snapshot_lsn;
+        this->pending_condition.notify_one();
+    }
+
+    std::uint64_t StateJournal::GetLastLsn() const
+    {
+        return this->next_lsn - 1;
+    }
+
+    std::uint64_t StateJournal::GetRecordsSinceSnapshot() const
+    {
+        return this->records_since_snapshot;
+    }
+
+    // ----------------------------------------------------------------------------------------------
+
+    void StateJournal::WriterLoop()
+    {
+        std::string records;
+        std::string snapshot;
+
+        for (;;)
+        {
+            bool has_snapshot = false;
+            std::uint64_t snapshot_lsn = 0;
+            bool stopping = false;
+
+            {
+                std::unique_lock<std::mutex> lock(this->pending_mutex);
+                this->pending_condition.wait_for(lock, std::chrono::milliseconds(journal_group_commit_ms), [this] { return this->has_pending_snapshot || !this->running; });
+
+                records.swap(this->pending_records);
+                if (this->has_pending_snapshot)
+                {
+                    snapshot.swap(this->pending_snapshot);
+                    snapshot_lsn = this->pending_snapshot_lsn;
+                    has_snapshot = true;
+                    this->has_pending_snapshot = false;
+                }
+
+                stopping = !this->running;
+            }
+
+            if (!records.empty() && this->wal_file)
+            {
+                std::fwrite(records.data(), 1, records.size(), this->wal_file);
+                SyncFile(this->wal_file);
+                records.clear();
+            }
+
+            // On failure the WAL keeps everything, and the next snapshot tries again.
+            if (has_snapshot)
+            {
+                if (this->WriteSnapshot(snapshot, snapshot_lsn)) this->TruncateWal(snapshot_lsn);
+                snapshot.clear();
+            }
+
+            if (stopping) return;
+        }
+    }
+
+    bool StateJournal::WriteSnapshot(const std::string& snapshot, const std::uint64_t snapshot_lsn)
+    {
+        // Written aside and renamed, so a crash never leaves a half snapshot behind.
+        const std::string temporary_path = this->snapshot_path + ".tmp";
+        std::FILE* file = std::fopen(temporary_path.c_str(), "wb");
+        if (!file) return false;
+
+        char snapshot_head[journal_magic_size + 8];
+        std::memcpy(snapshot_head, journal_snapshot_magic, journal_magic_size);
+        Utility::WriteLittleEndian(&snapshot_head[journal_magic_size], snapshot_lsn, 8);
+
+        const bool written = std::fwrite(snapshot_head, 1, sizeof(snapshot_head), file) == sizeof(snapshot_head) && std::fwrite(snapshot.data(), 1, snapshot.size(), file) == snapshot.size();
+        SyncFile(file);
+        std::fclose(file);
+
+        if (!written)
+        {
+            std::remove(temporary_path.c_str());
+            return false;
+        }
+
+#ifdef _WIN32
+        std::remove(this->snapshot_path.c_str()); // "rename" doesn't overwrite on Windows.
+#endif
+        return std::rename(temporary_path.c_str(), this->snapshot_path.c_str()) == 0;
+    }
+
+    void StateJournal::TruncateWal(const std::uint64_t snapshot_lsn)
+    {
+        // Older records are now covered by the snapshot (and skipped by their LSN if the truncation is lost):
+        // the newer ones, appended while the snapshot was built, are copied into a new WAL renamed over the old one.
+        std::vector<char> content;
+        if (!ReadWholeFile(this->wal_path, content)) return;
+
+        std::size_t offset = 0;
+        while (offset + journal_record_head_size <= content.size())
+        {
+            const std::size_t payload_length = Utility::ReadLittleEndian(&content[offset], 4);
+            const std::uint64_t lsn = Utility::ReadLittleEndian(&content[offset + 4], 8);
+            if (lsn > snapshot_lsn || offset + journal_record_head_size + payload_length > content.size()) break;
+
+            offset += journal_record_head_size + payload_length;
+        }
+
+        const std::string temporary_path = this->wal_path + ".tmp";
+        std::FILE* file = std::fopen(temporary_path.c_str(), "wb");
+        if (!file) return;
+
+        const bool written = std::fwrite(content.data() + offset, 1, content.size() - offset, file) == content.size() - offset;
+        SyncFile(file);
+        std::fclose(file);
+
+        if (!written)
+        {
+            std::remove(temporary_path.c_str());
+            return;
+        }
+
+        if (this->wal_file) std::fclose(this->wal_file);
+#ifdef _WIN32
+        std::remove(this->wal_path.c_str());
+#endif
+        std::rename(temporary_path.c_str(), this->wal_path.c_str());
+        this->wal_file = std::fopen(this->wal_path.c_str(), "ab");
+    }
+}
@@ -1,6 +1,8 @@
 #include <tictactoe_client.hpp>
 
-Client::Client(const char* ip_address, const int port)
+#include <algorithm>
+
+Client::Client(const char* ip_address, const int port, const bool headless, const char* script_path) : in_waiting_room(false), session_token(0), heartbeat_interval_seconds(default_heartbeat_interval_seconds), headless(headless), input(&std::cin), join_sent_ticks(0), first_update_received(false), last_received_sequence(0), sequence_window(reliable_sequence_space), sequences_reset(false)
 {
 #ifdef _WIN32
     try
@@ -39,14 +41,40 @@ Client::Client(const char* ip_address, const int port)
     this->command_functions_snd[Command::CREATE_ROOM] = [this](const int currentCommandID) { this->CreateRoomCommand(currentCommandID); };
     this->command_functions_snd[Command::CHALLENGE] = [this](const int currentCommandID) { this->ChallengeCommand(currentCommandID); };
     this->command_functions_snd[Command::QUIT] = [this](const int currentCommandID) { this->QuitCommand(currentCommandID); };
+    this->command_functions_snd[Command::QUICK_MATCH] = [this](const int currentCommandID) { this->QuickMatchCommand(currentCommandID); };
+    this->command_functions_snd[Command::SPECTATE] = [this](const int currentCommandID) { this->SpectateCommand(currentCommandID); };
+    this->command_functions_snd[Command::CHALLENGE_PLAYER] = [this](const int currentCommandID) { this->ChallengePlayerCommand(currentCommandID); };
 
     this->command_functions_rcv[Command::ANNOUNCE_ROOM] = [this](char* buffer, const int len) { this->AnnounceRoomCommand(buffer, len); };
     this->command_functions_rcv[Command::START_GAME] = [this](char* buffer, const int len) { this->StartGameCommand(buffer, len); };
     this->command_functions_rcv[Command::UPDATE_FIELD] = [this](char* buffer, const int len) { this->UpdateFieldCommand(buffer, len); };
     this->command_functions_rcv[Command::RESET_CLIENT] = [this](char* buffer, const int len) { this->ResetClientCommand(buffer, len); };
+    this->command_functions_rcv[Command::PONG] = [this](char* buffer, const int len) { this->PongCommand(buffer, len); };
+    this->command_functions_rcv[Command::SESSION] = [this](char* buffer, const int len) { this->SessionCommand(buffer, len); };
 
     // --------------------------------------------------------------------------------------------
 
+    if (this->headless)
+    {
+        if (script_path)
+        {
+            this->script_file.open(script_path);
+            if (!this->script_file)
+            {
+                throw std::runtime_error(std::string("Unable to open script file: ") + script_path);
+            }
+
+            this->input = &this->script_file;
+        }
+
+        // No window, no renderer and no PNG decoding: the client is ready as soon as the socket is.
+        this->EmitEvent("event=READY");
+        return;
+    }
+
+#ifdef TTT_HEADLESS_ONLY
+    throw std::runtime_error("Built with TTT_HEADLESS_ONLY: only the headless mode is available");
+#else
     if (SDL_Init(SDL_INIT_VIDEO) != 0)
     {
         throw std::runtime_error(std::string("Unable to initialize SDL: %s", SDL_GetError()));
@@ -67,24 +95,38 @@ Client::Client(const char* ip_address, const int port)
     this->InitSprites();
 
     std::cout << "Client is ready!\n\n";
+#endif
 }
 
 Client::~Client()
 {    
     // Detach these threads from the main thread. The OS will handle they life cycle.
-    send_thread.detach();
-    recv_thread.detach();
+    if (send_thread.joinable()) send_thread.detach();
+    if (recv_thread.joinable()) recv_thread.detach();
+    if (heartbeat_thread.joinable()) heartbeat_thread.detach();
+
+#ifndef TTT_HEADLESS_ONLY
+    if (this->headless) return;
 
     if (this->renderer) SDL_DestroyRenderer(renderer);
     if (this->window) SDL_DestroyWindow(window);
     SDL_Quit();
+#endif
 }
 
 void Client::Run()
 {
+    if (this->headless)
+    {
+        this->RunHeadless();
+        return;
+    }
+
+#ifndef TTT_HEADLESS_ONLY
     // Threads init.
     this->recv_thread = std::thread(&Client::ReceiveData, this);
     this->send_thread = std::thread(&Client::SendData, this);
+    this->heartbeat_thread = std::thread(&Client::Heartbeat, this);
 
     while (running)
     {
@@ -105,10 +147,10 @@ void Client::Run()
                 if (clicked_cell < 0) continue;
 
                 header_t header;
-                header.rid = 0;
+                header.rid = this->last_received_sequence; // Piggybacked acknowledgement.
                 header.command = Command::MOVE;
 
-                std::string move_info(std::to_string(header.rid) + std::to_string(static_cast<int>(header.command)) + std::to_string(clicked_cell));
+                std::string move_info(this->EncodeHeader(header.rid, header.command) + std::to_string(clicked_cell));
                 const char* move_packet = move_info.c_str();  
 
                 int sent_bytes = sendto(this->socket_id, move_packet, strlen(move_packet), 0, reinterpret_cast<sockaddr*>(&sin), sizeof(sin));
@@ -127,8 +169,60 @@ void Client::Run()
 
         SDL_RenderPresent(renderer);
     }   
+#endif
+}
+
+void Client::RunHeadless()
+{
+    this->recv_thread = std::thread(&Client::ReceiveData, this);
+    this->heartbeat_thread = std::thread(&Client::Heartbeat, this);
+
+    // Script syntax: one command per token group, using the same IDs of the interactive mode.
+    // "0 <name>" | "1" | "2 <room_id>" | "3 <cell>" | "4" | "wait <milliseconds>"
+    std::string token;
+    bool quit_sent = false;
+
+    while (running && (*this->input >> token))
+    {
+        if (token == "wait")
+        {
+            int milliseconds = 0;
+            *this->input >> milliseconds;
+            std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+            continue;
+        }
+
+        if (!token.empty() && token.size() <= 2 && std::all_of(token.begin(), token.end(), ::isdigit)) // One or two figures.
+        {
+            const int current_command_id = std::stoi(token);
+            const Command current_command = static_cast<Command>(current_command_id);
+
+            if (current_command == Command::MOVE)
+            {
+                this->MoveCommand(current_command_id);
+                continue;
+            }
+
+            if (this->command_functions_snd.count(current_command) > 0)
+            {
+                this->command_functions_snd[current_command](current_command_id);
+                quit_sent = current_command == Command::QUIT;
+                if (quit_sent) break;
+
+                continue;
+            }
+        }
+
+        this->EmitEvent("event=ERROR reason=invalid_command token=" + token);
+    }
+
+    if (!quit_sent) this->command_functions_snd[Command::QUIT](static_cast<int>(Command::QUIT));
+    running = false;
+
+    this->EmitEvent("event=EXIT");
 }
 
+#ifndef TTT_HEADLESS_ONLY
 void Client::InitSprites()
 {
     this->sprites.reserve(sprites_amount);
@@ -179,30 +273,81 @@ int Client::ClickedOnWhichCell(SDL_Event* event)
 
     return -1;
 }
+#endif
 
 // ------------------------------------------------------------------------------------------------
 
 void Client::ReceiveData()
 {
-    header_t header; 
-    char buffer[buffer_size];
+    char buffer[frame_buffer_size];
     sockaddr_in sender_in;
-    int sender_in_size = sizeof(sender_in); 
+    socklen_t sender_in_size = sizeof(sender_in); 
 
     while (running)
     {
-        int len = recvfrom(this->socket_id, buffer, buffer_size, 0, reinterpret_cast<sockaddr*>(&sender_in), &sender_in_size); 
+        int len = recvfrom(this->socket_id, buffer, frame_buffer_size, 0, reinterpret_cast<sockaddr*>(&sender_in), &sender_in_size); 
         if (len < 0) continue;
 
-        if (len < header_bytes_amount)
+        this->HandlePacket(buffer, len);
+    }
+}
+
+void Client::HandlePacket(char* buffer, const int len)
+{
+    header_t header; 
+
+    if (len < static_cast<int>(header_bytes_amount))
+    {
+        std::cout << "Invalid packet size: " << len << " bytes!\n";
+        return;
+    }   
+
+    header.rid = static_cast<unsigned char>(buffer[0]) - '0';
+    header.command = static_cast<Command>(buffer[1] - '0');
+
+    // | FRAME header | length (1 byte) | packet | length | packet | ...: a truncated packet ends the frame.
+    if (header.command == Command::FRAME)
+    {
+        for (int offset = header_bytes_amount; offset < len; )
         {
-            std::cout << "Invalid packet size: " << len << " bytes!\n";
-            continue;
-        }   
+            const int packet_len = static_cast<unsigned char>(buffer[offset]);
+            if (offset + 1 + packet_len > len) break;
+
+            this->HandlePacket(&buffer[offset + 1], packet_len);
+            offset += 1 + packet_len;
+        }
+
+        return;
+    }
+
+    if (header.rid != 0)
+    {
+        // The ACK of "SESSION" must already carry the token it delivers.
+        const bool is_stale = this->IsStaleSequence(header.command, header.rid);
+        if (!is_stale && header.command == Command::SESSION) this->SessionCommand(buffer, len);
+
+        this->Acknowledge(header.rid);
+        if (is_stale || header.command == Command::SESSION) return;
+    }
+
+    if (header.command == Command::COOKIE)
+    {
+        this->CookieCommand(buffer, len);
+        return;
+    }
 
-        header.rid = buffer[0] - '0';
-        header.command = static_cast<Command>(buffer[1] - '0');
+    if (header.command == Command::WAITING_ROOM)
+    {
+        this->WaitingRoomCommand(buffer, len);
+        return;
+    }
 
+    // The first game update (announces, heartbeats and the JOIN handshake don't count).
+    const bool is_game_update = header.command == Command::START_GAME || header.command == Command::UPDATE_FIELD;
+    if (is_game_update && !this->first_update_received) this->ReportFirstUpdateLatency();
+
+    if (this->command_functions_rcv.count(header.command) > 0)
+    {
         this->command_functions_rcv[header.command](buffer, len);
     }
 }
@@ -220,14 +365,14 @@ void Client::SendData()
         std::cout << "\nInsert a command: ";
         std::cin >> current_command_id_str;  
 
-        if (current_command_id_str.size() == 1) // One figure.
+        if (!current_command_id_str.empty() && current_command_id_str.size() <= 2 && std::all_of(current_command_id_str.begin(), current_command_id_str.end(), ::isdigit)) // One or two figures.
         {
-            current_command_id = current_command_id_str[0] - '0';
+            current_command_id = std::stoi(current_command_id_str);
             current_command = static_cast<Command>(current_command_id);
             
             // Command '3' is bound to the move, but the client activates this command by clicking on the cells.
             // So, the command '3' is not allowed! The command '4' is implicit when the window is closed.
-            if (current_command >= 0 && current_command < (command_functions_snd.size() - 1))
+            if (current_command != Command::QUIT && this->command_functions_snd.count(current_command) > 0)
             {
                 this->command_functions_snd[current_command](current_command_id);
                 continue;
@@ -247,73 +392,164 @@ void Client::SendData()
 void Client::JoinCommand(const int current_command_id)
 {
     std::string player_name;
-    std::cout << "Insert your name: ";
-    std::cin >> player_name;
-     
+    if (!this->headless) std::cout << "Insert your name: ";
+    *this->input >> player_name;
+
+    // The server expects a fixed-size name field, so the packet is padded with '\0'.
     std::string join_info('0' + std::to_string(current_command_id) + player_name);
+    join_info.resize(join_packet_size, '\0');
     const char* join_packet = join_info.c_str();
 
+    this->join_sent_ticks = std::chrono::steady_clock::now().time_since_epoch().count();
+    this->first_update_received = false;
+    this->sequences_reset = true; // A new session on the server restarts from sequence 1.
+    this->in_waiting_room = false;
+
     int sent_bytes = sendto(socket_id, join_packet, join_packet_size, 0, reinterpret_cast<sockaddr*>(&sin), sizeof(sin));
-    std::cout << "You have attempted to connect to the server!\n";
+
+    {
+        std::lock_guard<std::mutex> lock(this->join_mutex);
+        this->join_info = join_info;
+    }
+
+    if (this->headless) this->EmitEvent("event=SENT command=JOIN name=" + player_name);
+    else std::cout << "You have attempted to connect to the server!\n";
 }
 
 void Client::CreateRoomCommand(const int current_command_id)
 {
-    std::string create_room_info('0' + std::to_string(current_command_id));
+    std::string create_room_info(this->EncodeHeader(0, current_command_id));
     const char* create_room_packet = create_room_info.c_str();
 
     int sent_bytes = sendto(socket_id, create_room_packet, create_room_packet_size, 0, reinterpret_cast<sockaddr*>(&sin), sizeof(sin));
-    std::cout << "You have attempted to create a room into the server!\n";
+
+    if (this->headless) this->EmitEvent("event=SENT command=CREATE_ROOM");
+    else std::cout << "You have attempted to create a room into the server!\n";
 }
 
 void Client::ChallengeCommand(const int current_command_id)
 {
     std::uint32_t room_id;
-    std::cout << "Insert room ID: ";
-    std::cin >> room_id;
+    if (!this->headless) std::cout << "Insert room ID: ";
+    *this->input >> room_id;
 
     std::string room_id_str(std::to_string(room_id));   
-    std::string challenge_info('0' + std::to_string(current_command_id) + Utility::GetParsedRoomIDLength(room_id_str, room_id_str.length()) + room_id_str);
+    std::string challenge_info(this->EncodeHeader(0, current_command_id) + Utility::GetParsedRoomIDLength(room_id_str, room_id_str.length()) + room_id_str);
     const char* challenge_packet = challenge_info.c_str();
 
-    int sent_bytes = sendto(socket_id, challenge_packet, strlen(challenge_packet), 0, reinterpret_cast<sockaddr*>(&sin), sizeof(sin));
-    std::cout << "You have attempted to challenge someone into the server!\n";
+    int sent_bytes = sendto(socket_id, challenge_packet, challenge_info.size(), 0, reinterpret_cast<sockaddr*>(&sin), sizeof(sin));
+
+    if (this->headless) this->EmitEvent("event=SENT command=CHALLENGE room_id=" + room_id_str);
+    else std::cout << "You have attempted to challenge someone into the server!\n";
 }
 
 void Client::QuitCommand(const int current_command_id)
 {
-    std::string quit_info('0' + std::to_string(current_command_id));
+    std::string quit_info(this->EncodeHeader(0, current_command_id));
     const char* quit_packet = quit_info.c_str(); 
 
     int sent_bytes = sendto(socket_id, quit_packet, quit_packet_size, 0, reinterpret_cast<sockaddr*>(&sin), sizeof(sin));
-    std::cout << "\nYou have attempted to quit to the server!\n";
+
+    if (this->headless) this->EmitEvent("event=SENT command=QUIT");
+    else std::cout << "\nYou have attempted to quit to the server!\n";
+}
+
+void Client::QuickMatchCommand(const int current_command_id)
+{
+    std::string quick_match_info(this->EncodeHeader(0, current_command_id));
+    const char* quick_match_packet = quick_match_info.c_str();
+
+    int sent_bytes = sendto(socket_id, quick_match_packet, quick_match_packet_size, 0, reinterpret_cast<sockaddr*>(&sin), sizeof(sin));
+
+    if (this->headless) this->EmitEvent("event=SENT command=QUICK_MATCH");
+    else std::cout << "You have joined the quick match queue!\n";
+}
+
+void Client::SpectateCommand(const int current_command_id)
+{
+    std::uint32_t room_id;
+    if (!this->headless) std::cout << "Insert room ID: ";
+    *this->input >> room_id;
+
+    // Command IDs greater than 9 don't fit "std::to_string": the header is always two bytes.
+    std::string room_id_str(std::to_string(room_id));
+    std::string spectate_info(this->EncodeHeader(0, current_command_id) + Utility::GetParsedRoomIDLength(room_id_str, room_id_str.length()) + room_id_str);
+    const char* spectate_packet = spectate_info.c_str();
+
+    int sent_bytes = sendto(socket_id, spectate_packet, spectate_info.size(), 0, reinterpret_cast<sockaddr*>(&sin), sizeof(sin));
+
+    if (this->headless) this->EmitEvent("event=SENT command=SPECTATE room_id=" + room_id_str);
+    else std::cout << "You have attempted to spectate a room!\n";
+}
+
+void Client::ChallengePlayerCommand(const int current_command_id)
+{
+    std::string player_name;
+    if (!this->headless) std::cout << "Insert the name of the room owner: ";
+    *this->input >> player_name;
+
+    std::string challenge_player_info(this->EncodeHeader(0, current_command_id) + player_name.substr(0, player_name_bytes_amount));
+    const char* challenge_player_packet = challenge_player_info.c_str();
+
+    int sent_bytes = sendto(socket_id, challenge_player_packet, challenge_player_info.size(), 0, reinterpret_cast<sockaddr*>(&sin), sizeof(sin));
+
+    if (this->headless) this->EmitEvent("event=SENT command=CHALLENGE_PLAYER name=" + player_name);
+    else std::cout << "You have attempted to challenge \"" << player_name << "\"!\n";
+}
+
+// Only used by the headless mode: the graphical client sends moves by clicking on the cells.
+void Client::MoveCommand(const int current_command_id)
+{
+    int cell;
+    *this->input >> cell;
+
+    std::string move_info(this->EncodeHeader(this->last_received_sequence, current_command_id) + std::to_string(cell));
+    const char* move_packet = move_info.c_str();
+
+    int sent_bytes = sendto(socket_id, move_packet, move_packet_size, 0, reinterpret_cast<sockaddr*>(&sin), sizeof(sin));
+    this->EmitEvent("event=SENT command=MOVE cell=" + std::to_string(cell));
 }
 
 // ------------------------------------------------------------------------------------------------
 
 void Client::StartGameCommand(char* buffer, const int len)
 {
+    if (this->headless)
+    {
+        this->EmitEvent("event=START_GAME");
+        return;
+    }
+
+#ifndef TTT_HEADLESS_ONLY
     this->sprites[0].SetTexture(nullptr);
     this->sprites[1].SetTexture(textures[PLAY_GRID]);
+#endif
 }
 
 void Client::AnnounceRoomCommand(char* buffer, const int len)
 {
-    std::string room_id_length_str;
-    std::memcpy(&room_id_length_str, &buffer[header_bytes_amount], room_id_len);
-    const std::uint32_t room_id_length = std::stoull(room_id_length_str);
-
-    std::string room_id_bytes;
-    std::memcpy(&room_id_bytes, &buffer[header_bytes_amount + room_id_len], room_id_length);
+    int room_id = Utility::ParseRoomID(buffer, len, header_bytes_amount, room_id_len);
+    if (room_id < 0) return;
 
-    int room_id = std::stoi(room_id_bytes);
-    std::cout << "\nAnnouncing room " << room_id;
+    if (this->headless) this->EmitEvent("event=ANNOUNCE_ROOM room_id=" + std::to_string(room_id));
+    else std::cout << "\nAnnouncing room " << room_id;
 }
 
 void Client::UpdateFieldCommand(char* buffer, const int len)
 {
     if (len != sprites_amount) return;
 
+    if (this->headless)
+    {
+        // Empty cells are written as '.' so the field is always a single whitespace-free token.
+        std::string field(&buffer[starting_sprite_cells_index], sprites_cell_amount);
+        std::replace(field.begin(), field.end(), ' ', '.');
+
+        this->EmitEvent("event=UPDATE_FIELD field=" + field);
+        return;
+    }
+
+#ifndef TTT_HEADLESS_ONLY
     for (size_t i = starting_sprite_cells_index; i < sprites_amount; i++)
     {
         switch (buffer[i])
@@ -336,20 +572,171 @@ void Client::UpdateFieldCommand(char* buffer, const int len)
             case '?': break; // Nothing.
         }
     }
+#endif
 }
 
 void Client::ResetClientCommand(char* buffer, const int len)
 {
+    if (this->headless)
+    {
+        this->EmitEvent("event=RESET_CLIENT");
+        return;
+    }
+
+#ifndef TTT_HEADLESS_ONLY
     for (auto it = sprites.begin(); it != sprites.end(); ++it)
     {
         it->SetTexture(nullptr);
     }
 
     sprites[0].SetTexture(textures[BLOCKED_GRID]);
+#endif
+}
+
+void Client::PongCommand(char* buffer, const int len)
+{
+    if (len <= static_cast<int>(header_bytes_amount)) return;
+
+    std::uint32_t interval = 0;
+    for (int i = header_bytes_amount; i < len; i++)
+    {
+        if (buffer[i] < '0' || buffer[i] > '9') return;
+        interval = interval * 10 + (buffer[i] - '0');
+    }
+
+    if (interval == 0 || interval == this->heartbeat_interval_seconds) return;
+
+    this->heartbeat_interval_seconds = interval;
+    if (this->headless) this->EmitEvent("event=HEARTBEAT_INTERVAL seconds=" + std::to_string(interval));
+}
+
+void Client::SessionCommand(char* buffer, const int len)
+{
+    if (len != header_bytes_amount + session_token_bytes_amount) return;
+
+    this->session_token = Utility::ReadLittleEndian(&buffer[header_bytes_amount], session_token_bytes_amount);
+    this->in_waiting_room = false;
+    if (this->headless) this->EmitEvent("event=SESSION");
+}
+
+void Client::CookieCommand(char* buffer, const int len)
+{
+    if (len != header_bytes_amount + join_cookie_bytes_amount) return;
+
+    std::string join_info;
+    {
+        std::lock_guard<std::mutex> lock(this->join_mutex);
+        join_info = this->join_info;
+    }
+    if (join_info.empty()) return;
+
+    // Same JOIN, with the cookie echoed after the name: only now the server creates the session.
+    join_info.append(&buffer[header_bytes_amount], join_cookie_bytes_amount);
+    int sent_bytes = sendto(socket_id, join_info.c_str(), join_info.size(), 0, reinterpret_cast<sockaddr*>(&sin), sizeof(sin));
+
+    if (this->headless) this->EmitEvent("event=COOKIE");
+}
+
+void Client::WaitingRoomCommand(char* buffer, const int len)
+{
+    if (len <= static_cast<int>(header_bytes_amount)) return;
+
+    std::uint64_t position = 0;
+    for (int i = header_bytes_amount; i < len; i++)
+    {
+        if (buffer[i] < '0' || buffer[i] > '9') return;
+        position = position * 10 + (buffer[i] - '0');
+    }
+
+    // "Heartbeat" sends the JOIN again from now on.
+    this->in_waiting_room = true;
+
+    if (this->headless) this->EmitEvent("event=WAITING_ROOM position=" + std::to_string(position));
+    else if (position == 0) std::cout << "\nThe server is full, trying again...\n";
+    else std::cout << "\nWaiting room: position " << position << "\n";
+}
+
+std::string Client::EncodeHeader(const std::uint32_t rid, const std::uint32_t command) const
+{
+    std::string header_info(Utility::EncodeHeader(rid, command));
+    Utility::AppendLittleEndian(header_info, this->session_token, session_token_bytes_amount);
+    return header_info;
+}
+
+void Client::ReportFirstUpdateLatency()
+{
+    const std::int64_t join_sent = this->join_sent_ticks;
+    if (join_sent == 0) return;
+
+    this->first_update_received = true;
+
+    const std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now().time_since_epoch() - std::chrono::steady_clock::duration(join_sent);
+    const double elapsed_ms = std::chrono::duration<double, std::milli>(elapsed).count();
+
+    if (this->headless) this->EmitEvent("event=LATENCY connect_to_first_update_ms=" + std::to_string(elapsed_ms));
+    else std::cout << "\nConnect-to-first-update latency: " << elapsed_ms << " ms\n";
+}
+
+void Client::Heartbeat()
+{
+    std::chrono::steady_clock::time_point next_ping = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point next_join = next_ping;
+
+    // Short sleeps, so that the thread notices both the end of the client and a new interval.
+    while (running)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+        if (this->session_token == 0)
+        {
+            // Into the waiting room the place is kept only while the JOINs keep coming.
+            if (!this->in_waiting_room || now < next_join) continue;
+
+            std::string join_info;
+            {
+                std::lock_guard<std::mutex> lock(this->join_mutex);
+                join_info = this->join_info;
+            }
+
+            int sent_bytes = sendto(this->socket_id, join_info.c_str(), join_info.size(), 0, reinterpret_cast<sockaddr*>(&sin), sizeof(sin));
+            next_join = now + std::chrono::seconds(waiting_room_retry_seconds);
+            continue;
+        }
+
+        if (now < next_ping) continue;
+
+        std::string ping_info(this->EncodeHeader(0, Command::PING));
+        int sent_bytes = sendto(this->socket_id, ping_info.c_str(), ping_packet_size, 0, reinterpret_cast<sockaddr*>(&sin), sizeof(sin));
+
+        next_ping = now + std::chrono::seconds(this->heartbeat_interval_seconds);
+    }
+}
+
+void Client::Acknowledge(const std::uint32_t sequence)
+{
+    this->last_received_sequence = sequence;
+
+    std::string ack_info(this->EncodeHeader(sequence, Command::ACK));
+    int sent_bytes = sendto(this->socket_id, ack_info.c_str(), ack_packet_size, 0, reinterpret_cast<sockaddr*>(&sin), sizeof(sin));
+}
+
+bool Client::IsStaleSequence(const Command command, const std::uint32_t sequence)
+{
+    if (this->sequences_reset.exchange(false)) this->sequence_window.Reset();
+    return this->sequence_window.IsStale(command, sequence);
+}
+
+void Client::EmitEvent(const std::string& event_info)
+{
+    // Both the script thread and the "ReceiveData" thread write events: one full line at a time.
+    std::lock_guard<std::mutex> lock(this->output_mutex);
+    std::cout << event_info << std::endl;
 }
 
 // ------------------------------------------------------------------------------------------------
 
+#ifndef TTT_HEADLESS_ONLY
 SDL_Texture* NaiveSDLTexture::GetTexture() const
 {
     return this->texture;
@@ -364,19 +751,31 @@ SDL_Rect& NaiveSDLTexture::GetTextureBox()
 {
     return this->texture_box;
 }
+#endif
 
 // ------------------------------------------------------------------------------------------------
 
 void Client::PrintCommands() const
 {
-    std::cout << "COMMAND LIST:\n-0: Join\n-1: Create Room\n-2: Challenge\n-Click On a Cell: Move\n-Close Window: Quit\n";
+    std::cout << "COMMAND LIST:\n-0: Join\n-1: Create Room\n-2: Challenge\n-9: Quick Match\n-10: Spectate\n-15: Challenge Player\n-Click On a Cell: Move\n-Close Window: Quit\n";
 }
 
 // ------------------------------------------------------------------------------------------------
 
+// Usage: tictactoe_client.exe [--headless [script_path]]
+// Built with "TTT_HEADLESS_ONLY": tictactoe_client [--headless] [script_path]
 int main(int argc, char** argv)
 {
-    Client client = {};
+#ifdef TTT_HEADLESS_ONLY
+    const bool headless = true;
+    const int script_index = (argc > 1 && std::string(argv[1]) == "--headless") ? 2 : 1;
+    const char* script_path = argc > script_index ? argv[script_index] : nullptr;
+#else
+    const bool headless = argc > 1 && std::string(argv[1]) == "--headless";
+    const char* script_path = (headless && argc > 2) ? argv[2] : nullptr;
+#endif
+
+    Client client("127.0.0.1", 9999, headless, script_path);
     client.Run();
 
     return EXIT_SUCCESS;
@@ -1,8 +1,19 @@
 #include <tictactoe_server.hpp>
 
 #include <iostream>
+#include <fstream>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <random>
+
+#ifdef __linux__
+    #include <unistd.h>
+    #include <pthread.h>
+    #include <sched.h>
+#endif
 
-Server::Server(const char* ip_address, const int port, const std::uint32_t timeout)
+Server::Server(const char* ip_address, const int port, const std::uint32_t timeout, const bool open_socket) : receive_timeout_ms(timeout)
 {
 #ifdef _WIN32
     try
@@ -19,7 +30,7 @@ Server::Server(const char* ip_address, const int port, const std::uint32_t timeo
     }
 #endif
 
-    try
+    if (open_socket) try
     {
         this->socket_id = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
         if (this->socket_id < 0)
@@ -31,21 +42,34 @@ Server::Server(const char* ip_address, const int port, const std::uint32_t timeo
         this->sin.sin_family = AF_INET;
         this->sin.sin_port = htons(port);
 
+        // Winsock takes the receive timeout in milliseconds, POSIX systems take a "timeval".
+#ifdef _WIN32
+        const DWORD receive_timeout = timeout;
+#else
+        const timeval receive_timeout = { static_cast<time_t>(timeout / 1000), static_cast<suseconds_t>((timeout % 1000) * 1000) };
+#endif
+
         // "reinterpret_cast" is great to modify the interpretation about a memory address.
-        if (setsockopt(this->socket_id, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(std::uint32_t)))
+        if (setsockopt(this->socket_id, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&receive_timeout), sizeof(receive_timeout)))
         {
             throw NetworkException("ERROR: Unable to set socket option for receive timeout!\n");
         }
 
-        if (setsockopt(this->socket_id, SOL_SOCKET, SO_RCVBUF, reinterpret_cast<const char*>(&buffer_size), sizeof(std::uint32_t)))
+        this->SetSocketBuffers(default_socket_buffer_bytes, default_socket_buffer_bytes);
+
+#ifdef __linux__
+        // The kernel reports its drop counter and its receive timestamp with every datagram (see "Tick").
+        const int enable = 1;
+        if (setsockopt(this->socket_id, SOL_SOCKET, SO_RXQ_OVFL, &enable, sizeof(enable)))
         {
-            throw NetworkException("ERROR: Unable to set socket option for receive buffer size!\n");
+            throw NetworkException("ERROR: Unable to set socket option for the drops report!\n");
         }
 
-        if (setsockopt(this->socket_id, SOL_SOCKET, SO_SNDBUF, reinterpret_cast<const char*>(&buffer_size), sizeof(std::uint32_t)))
+        if (setsockopt(this->socket_id, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof(enable)))
         {
-            throw NetworkException("ERROR: Unable to set socket option for send buffer size!\n");
+            throw NetworkException("ERROR: Unable to set socket option for the receive timestamps!\n");
         }
+#endif
 
         if (bind(this->socket_id, reinterpret_cast<sockaddr*>(&this->sin), sizeof(this->sin)))
         {
@@ -57,26 +81,152 @@ Server::Server(const char* ip_address, const int port, const std::uint32_t timeo
         std::cout << exception.what() << "\n";
     }
 
+    // The steady state works into these capacities: no allocation per packet.
+    this->pending_spectator_broadcasts.reserve(pending_broadcasts_capacity);
+    this->outbound_frames.reserve(outbound_frames_capacity);
+    this->game_lane.slots.resize(receive_batch_size);
+    this->lobby_lane.slots.resize(lobby_lane_capacity);
+
+    // Never from the seeded generator ("--seed"): a predictable salt would let anybody guess the tokens of the other players.
+    std::random_device random_device;
+    for (std::uint64_t& key : this->session_token_key)
+    {
+        key = (static_cast<std::uint64_t>(random_device()) << 32) | random_device();
+    }
+
+    std::vector<retransmission_timer_t> timers;
+    timers.reserve(retransmission_timers_capacity);
+    this->retransmission_timers = decltype(this->retransmission_timers)(std::greater<retransmission_timer_t>(), std::move(timers));
+
     // Init commands. I must use the lambda expressions.
     this->commandFunctions[Command::JOIN] = [this](char* buffer, Sender& sender, const int len) { this->JoinCommand(buffer, sender, len); };
     this->commandFunctions[Command::CREATE_ROOM] = [this](char* buffer, Sender& sender, const int len) { this->CreateRoomCommand(buffer, sender, len); };
     this->commandFunctions[Command::CHALLENGE] = [this](char* buffer, Sender& sender, const int len) { this->ChallengeCommand(buffer, sender, len); };
     this->commandFunctions[Command::MOVE] = [this](char* buffer, Sender& sender, const int len) { this->MoveCommand(buffer, sender, len); };
     this->commandFunctions[Command::QUIT] = [this](char* buffer, Sender& sender, const int len) { this->QuitCommand(buffer, sender, len); };
+    this->commandFunctions[Command::QUICK_MATCH] = [this](char* buffer, Sender& sender, const int len) { this->QuickMatchCommand(buffer, sender, len); };
+    this->commandFunctions[Command::SPECTATE] = [this](char* buffer, Sender& sender, const int len) { this->SpectateCommand(buffer, sender, len); };
+    this->commandFunctions[Command::ACK] = [this](char* buffer, Sender& sender, const int len) { this->AckCommand(buffer, sender, len); };
+    this->commandFunctions[Command::PING] = [this](char* buffer, Sender& sender, const int len) { this->PingCommand(buffer, sender, len); };
+    this->commandFunctions[Command::CHALLENGE_PLAYER] = [this](char* buffer, Sender& sender, const int len) { this->ChallengePlayerCommand(buffer, sender, len); };
 
     std::cout << "Server is ready!\n";
 }
 
+bool Server::EnableBusyPoll(const int cpu)
+{
+    if (this->socket_id < 0) return false;
+    bool enabled = true;
+
+#ifdef __linux__
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(cpu, &cpu_set);
+
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set))
+    {
+        std::cout << "WARNING: unable to pin the game thread to CPU " << cpu << "!\n";
+        enabled = false;
+    }
+
+    // The kernel polls the device queue while receiving, instead of waiting for the interrupt (CAP_NET_ADMIN above "net.core.busy_read").
+    const int busy_poll_us = busy_poll_microseconds;
+    if (setsockopt(this->socket_id, SOL_SOCKET, SO_BUSY_POLL, &busy_poll_us, sizeof(busy_poll_us)))
+    {
+        std::cout << "WARNING: \"SO_BUSY_POLL\" not allowed: spinning on the socket only!\n";
+    }
+#elif defined(_WIN32)
+    if (!SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(1) << cpu))
+    {
+        std::cout << "WARNING: unable to pin the game thread to CPU " << cpu << "!\n";
+        enabled = false;
+    }
+
+    // No per-call flag on Winsock: the whole socket becomes non-blocking.
+    u_long non_blocking = 1;
+    ioctlsocket(this->socket_id, FIONBIO, &non_blocking);
+#endif
+
+    this->busy_poll = true;
+    std::cout << "Busy poll enabled: game thread on CPU " << cpu << "\n";
+
+    return enabled;
+}
+
+// The size actually granted: the kernel may clamp the request (Linux: to "net.core.rmem_max" / "wmem_max").
+static int ApplySocketBuffer(const int socket_id, const int set_option, const int get_option, const int bytes)
+{
+    setsockopt(socket_id, SOL_SOCKET, set_option, reinterpret_cast<const char*>(&bytes), sizeof(bytes));
+
+    int granted_bytes = 0;
+    socklen_t granted_bytes_size = sizeof(granted_bytes);
+    if (getsockopt(socket_id, SOL_SOCKET, get_option, reinterpret_cast<char*>(&granted_bytes), &granted_bytes_size)) return 0;
+
+#ifdef __linux__
+    granted_bytes /= 2; // Linux doubles the request for its bookkeeping overhead, and reports the doubled value.
+#endif
+
+    return granted_bytes;
+}
+
+bool Server::SetSocketBuffers(const int receive_bytes, const int send_bytes)
+{
+    if (this->socket_id < 0) return false;
+
+    this->receive_buffer_bytes = ApplySocketBuffer(this->socket_id, SO_RCVBUF, SO_RCVBUF, receive_bytes);
+    this->send_buffer_bytes = ApplySocketBuffer(this->socket_id, SO_SNDBUF, SO_SNDBUF, send_bytes);
+
+#ifdef __linux__
+    // Above the system limits only a privileged process (CAP_NET_ADMIN) gets what it asks for.
+    if (this->receive_buffer_bytes < receive_bytes) this->receive_buffer_bytes = ApplySocketBuffer(this->socket_id, SO_RCVBUFFORCE, SO_RCVBUF, receive_bytes);
+    if (this->send_buffer_bytes < send_bytes) this->send_buffer_bytes = ApplySocketBuffer(this->socket_id, SO_SNDBUFFORCE, SO_SNDBUF, send_bytes);
+#endif
+
+    bool granted = true;
+    if (this->receive_buffer_bytes < receive_bytes)
+    {
+        std::cout << "WARNING: receive buffer of " << this->receive_buffer_bytes << " bytes instead of " << receive_bytes << " (raise \"net.core.rmem_max\")!\n";
+        granted = false;
+    }
+
+    if (this->send_buffer_bytes < send_bytes)
+    {
+        std::cout << "WARNING: send buffer of " << this->send_buffer_bytes << " bytes instead of " << send_bytes << " (raise \"net.core.wmem_max\")!\n";
+        granted = false;
+    }
+
+    return granted;
+}
+
 // ----------------------------------------------------------------------------------------------
 
 std::string Server::Sender::GetIpAddress() const
 {
-    return this->ip_address;
+    in_addr address;
+    address.s_addr = this->address;
+
+    char address_str[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &address, address_str, INET_ADDRSTRLEN);
+
+    return address_str;
 }
 
 void Server::Sender::SetIpAddress(const std::string& ip_address)
 {
-    this->ip_address = ip_address;
+    in_addr address;
+    if (inet_pton(AF_INET, ip_address.c_str(), &address) != 1) address.s_addr = 0;
+
+    this->address = address.s_addr;
+}
+
+std::uint32_t Server::Sender::GetAddress() const
+{
+    return this->address;
+}
+
+void Server::Sender::SetAddress(const std::uint32_t address)
+{
+    this->address = address;
 }
 
 // ----------------------------------------------------------------------------------------------
@@ -88,21 +238,24 @@ int Server::Sender::GetPort() const
 
 void Server::Sender::SetterPort(const int port) // "SetPort" was already defined.
 {
-    this->port = port;
+    this->port = static_cast<std::uint16_t>(port);
 }
 
 // ----------------------------------------------------------------------------------------------
 
 bool Server::Sender::operator==(const Sender& other_sender) const
 {
-    return ip_address == other_sender.ip_address && port == other_sender.port;
+    return this->address == other_sender.address && this->port == other_sender.port;
 }
 
 // ----------------------------------------------------------------------------------------------
 
 void Server::Kick(const Sender& sender)
 {
-    Player& bad_player = this->players[sender];
+    session_t* session = this->FindSession(sender);
+    if (!session) return;
+
+    Player& bad_player = session->second;
     int room_id = bad_player.GetCurrentRoom().first;
     bool is_owner = bad_player.GetCurrentRoom().second;
 
@@ -119,41 +272,47 @@ void Server::Kick(const Sender& sender)
         {
             this->ResetClient(current_room);
             current_room.Reset(true);
+            this->JournalRoom(current_room);
         }
     }
 
     std::cout << "[" << sender.GetIpAddress() << ":" << sender.GetPort() << "] \"" << bad_player.GetName() << "\" has been kicked!\n";
-    players.erase(sender);
+    this->ReleaseSender(sender);
+    this->JournalPlayerRemoval(sender);
 }
 
 void Server::DestroyRoom(const Room& room)
 {
     std::pair<int, bool> no_room_info = { -1, true };
 
-    // I can't use "const" because i assign a reference type.
-    for (auto& player : this->players)
+    session_t* challenger = this->GetSession(room.GetChallenger());
+    if (challenger)
     {
-        Player& challenger = player.second;
-        if (room.GetChallenger() && *room.GetChallenger() == challenger)
-        {
-            challenger.SetCurrentRoom(no_room_info);
-        }
+        challenger->second.SetCurrentRoom(no_room_info);
+        this->JournalPlayer(challenger->first, challenger->second);
     }
 
     std::cout << "Room with ID: " << room.GetRoomID() << " has been destroyed!\n";
-    opened_rooms.erase(room.GetRoomID());
-    rooms.erase(room.GetRoomID());
+    const int room_id = room.GetRoomID(); // "room" is a reference into "rooms".
+    this->DetachSpectators(room_id);
+    opened_rooms.erase(room_id);
+    rooms.erase(room_id);
+    this->JournalRoomRemoval(room_id);
 }
 
 void Server::RemovePlayer(const Sender& sender)
 {
-    Player& player = this->players[sender];
+    session_t* session = this->FindSession(sender);
+    if (!session) return;
+
+    Player& player = session->second;
     int current_room_id = player.GetCurrentRoom().first;
 
     if (current_room_id <= 0)
     {
         std::cout << "Player \"" << player.GetName() << "\" removed!\n";
-        players.erase(sender);
+        this->ReleaseSender(sender);
+        this->JournalPlayerRemoval(sender);
         return;
     }
 
@@ -161,13 +320,15 @@ void Server::RemovePlayer(const Sender& sender)
 
     if (room.GetChallenger())
     {
-        if (*room.GetChallenger() == player)
+        if (room.GetChallenger() == player.GetPlayerID())
         {
             this->ResetClient(room);
             room.Reset(true);
+            this->JournalRoom(room);
 
             std::cout << "Player \"" << player.GetName() << "\" removed!\n";
-            players.erase(sender);
+            this->ReleaseSender(sender);
+            this->JournalPlayerRemoval(sender);
 
             this->Announces(room.GetRoomID(), false);
             return;
@@ -178,21 +339,180 @@ void Server::RemovePlayer(const Sender& sender)
     this->DestroyRoom(room);
 
     std::cout << "Player \"" << player.GetName() << "\" removed!\n";
-    players.erase(sender);
+    this->ReleaseSender(sender);
+    this->JournalPlayerRemoval(sender);
 
-    this->Announces(room.GetRoomID(), true);
+    this->Announces(current_room_id, true);
+}
+
+// Same clock as the kernel receive timestamps ("CLOCK_REALTIME").
+static std::uint64_t ReadWallClockNanoseconds()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// In-game traffic: served first, whatever the lobby load (see "receive_batch_size").
+bool Server::IsInGame(const sockaddr_in& sender_input)
+{
+    Sender sender;
+    sender.SetAddress(sender_input.sin_addr.s_addr);
+    sender.SetterPort(ntohs(sender_input.sin_port));
+
+    const session_t* session = this->FindSession(sender);
+    return session && session->second.GetCurrentRoom().first > 0;
 }
 
 void Server::Tick()
 {
-    char buffer[buffer_size];
-    sockaddr_in sender_input;
-    int sender_input_size = sizeof(sender_input);
+    AllocationSite allocation_site("Tick");
+
+    // Busy poll: never sleep, the receive below doesn't block.
+    // Otherwise retransmission timers, spectator fan-outs and a lobby backlog can't wait for the whole receive timeout.
+    bool readable = true;
+    const int wait_ms = this->GetReceiveWait();
+    if (!this->busy_poll && wait_ms < static_cast<int>(this->receive_timeout_ms))
+    {
+        fd_set read_set;
+        FD_ZERO(&read_set);
+        FD_SET(this->socket_id, &read_set);
+
+        timeval wait_time = { wait_ms / 1000, (wait_ms % 1000) * 1000 };
+        readable = select(this->socket_id + 1, &read_set, nullptr, nullptr, &wait_time) > 0;
+    }
+
+    // Only the first read may block: the next ones take what's already queued into the socket.
+    std::size_t read_amount = 0;
+    received_datagram_t datagram;
+    while (read_amount < receive_batch_size)
+    {
+        const int len = readable ? this->ReceiveDatagram(datagram, read_amount == 0) : -1;
+
+        // The only clock read of the tick: dispatch and checks below share this value.
+        if (read_amount == 0) Clock::Update();
+        if (len < 0) break;
+        read_amount++;
+
+        // Dropped before being queued: a flood costs a few counters, never a "players" lookup.
+        if (!this->heavy_hitters.Record(ntohl(datagram.sender_input.sin_addr.s_addr), Clock::GetNowMilliseconds())) continue;
+
+        // By endpoint, never by the (unauthenticated) command byte: a flood can't claim the game lane by sending moves.
+        lane_t& lane = this->IsInGame(datagram.sender_input) ? this->game_lane : this->lobby_lane;
+        if (lane.size == lane.slots.size())
+        {
+            lane.drops_amount++;
+            continue;
+        }
+
+        lane.slots[(lane.head + lane.size) % lane.slots.size()] = datagram;
+        lane.size++;
+    }
+
+    // Idle tick (receive timeout): good moment to persist the captured packets.
+    if (read_amount == 0 && this->capture) this->capture->Flush();
+
+    this->overloaded = read_amount == receive_batch_size || this->lobby_lane.size > lobby_datagrams_per_tick;
+
+    this->tick_start_ns = ReadWallClockNanoseconds();
+    this->ServeLane(this->game_lane, this->game_lane.size);
+    this->ServeLane(this->lobby_lane, this->shedding ? lobby_datagrams_per_tick / 4 : lobby_datagrams_per_tick);
+}
+
+int Server::ReceiveDatagram(received_datagram_t& datagram, const bool wait)
+{
+    sockaddr_in& sender_input = datagram.sender_input;
+    socklen_t sender_input_size = sizeof(sender_input);
+    char* buffer = datagram.data.data();
+
+#ifdef __linux__
+    // "recvmsg": the ancillary data carries the counter of the datagrams dropped so far by the kernel ("SO_RXQ_OVFL")
+    // and the time the datagram was received ("SO_TIMESTAMPNS").
+    iovec buffer_vector = { buffer, buffer_size };
+    char control[CMSG_SPACE(sizeof(std::uint32_t)) + CMSG_SPACE(sizeof(timespec))];
+    std::uint64_t receive_timestamp_ns = 0;
+
+    msghdr message;
+    std::memset(&message, 0, sizeof(message));
+    message.msg_name = &sender_input;
+    message.msg_namelen = sender_input_size;
+    message.msg_iov = &buffer_vector;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    int len = recvmsg(this->socket_id, &message, wait && !this->busy_poll ? 0 : MSG_DONTWAIT);
+    for (cmsghdr* control_message = CMSG_FIRSTHDR(&message); len >= 0 && control_message; control_message = CMSG_NXTHDR(&message, control_message))
+    {
+        if (control_message->cmsg_level == SOL_SOCKET && control_message->cmsg_type == SO_RXQ_OVFL)
+        {
+            std::memcpy(&this->kernel_drops_amount, CMSG_DATA(control_message), sizeof(std::uint32_t));
+        }
+        else if (control_message->cmsg_level == SOL_SOCKET && control_message->cmsg_type == SCM_TIMESTAMPNS)
+        {
+            timespec timestamp;
+            std::memcpy(&timestamp, CMSG_DATA(control_message), sizeof(timespec));
+            receive_timestamp_ns = static_cast<std::uint64_t>(timestamp.tv_sec) * 1000000000ull + timestamp.tv_nsec;
+        }
+    }
+#else
+    // A blocking socket (out of busy poll): checked first, so that only the first read of a batch can wait.
+    if (!wait && !this->busy_poll)
+    {
+        fd_set read_set;
+        FD_ZERO(&read_set);
+        FD_SET(this->socket_id, &read_set);
+
+        timeval no_wait = { 0, 0 };
+        if (select(this->socket_id + 1, &read_set, nullptr, nullptr, &no_wait) <= 0) return -1;
+    }
 
     int len = recvfrom(this->socket_id, buffer, buffer_size, 0, reinterpret_cast<sockaddr*>(&sender_input), &sender_input_size);
-    if (len < 0) return;
+#endif
+
+    if (len < 0) return len;
+
+    datagram.len = len;
+    datagram.read_timestamp_ns = ReadWallClockNanoseconds();
+#ifdef __linux__
+    if (receive_timestamp_ns > 0 && datagram.read_timestamp_ns > receive_timestamp_ns) this->receive_queueing_delay_us.Record((datagram.read_timestamp_ns - receive_timestamp_ns) / 1000);
+#endif
+
+    return len;
+}
+
+void Server::ServeLane(lane_t& lane, const std::size_t budget)
+{
+    if (lane.size > 0) lane.depth.Record(lane.size);
+
+    for (std::size_t served = 0; served < budget && lane.size > 0; served++)
+    {
+        // Taken out first: nothing is queued while dispatching, the slot stays untouched until the next read.
+        received_datagram_t& datagram = lane.slots[lane.head];
+        lane.head = (lane.head + 1) % lane.slots.size();
+        lane.size--;
+
+        const std::uint64_t dispatch_timestamp_ns = ReadWallClockNanoseconds();
+        if (dispatch_timestamp_ns > datagram.read_timestamp_ns) lane.wait_us.Record((dispatch_timestamp_ns - datagram.read_timestamp_ns) / 1000);
+        if (this->dispatched_amount < this->dispatch_timestamps_ns.size()) this->dispatch_timestamps_ns[this->dispatched_amount++] = dispatch_timestamp_ns;
+
+        // Recorded in dispatch order: a replay follows the same order as the lanes did.
+        if (this->capture) this->capture->Record(datagram.data.data(), datagram.len, datagram.sender_input.sin_addr.s_addr, ntohs(datagram.sender_input.sin_port));
+
+        this->Dispatch(datagram.data.data(), datagram.len, datagram.sender_input);
+    }
+}
+
+// Allocation sites of "Dispatch" (see "allocation_tracker.hpp"): one per command.
+static const char* const command_allocation_sites[] =
+{
+    "JOIN", "CREATE_ROOM", "CHALLENGE", "MOVE", "QUIT", "ANNOUNCE_ROOM", "START_GAME", "UPDATE_FIELD",
+    "RESET_CLIENT", "QUICK_MATCH", "SPECTATE", "ACK", "PING", "PONG", "SESSION", "CHALLENGE_PLAYER"
+};
 
-    if (len < header_bytes_amount)
+void Server::Dispatch(char* buffer, int len, const sockaddr_in& sender_input)
+{
+    this->dispatched_session = nullptr;
+
+    if (len < static_cast<int>(header_bytes_amount))
     {
         std::cout << "Invalid packet size: " << len << " bytes!\n";
         return;
@@ -201,17 +521,40 @@ void Server::Tick()
     // Packet Protocol: >II...
     // Big Endian | RID | Command | Payload (based on the command)
     header_t header;
-    header.rid = buffer[0] - '0';
+    header.rid = static_cast<unsigned char>(buffer[0]) - '0';
     header.command = static_cast<Command>(buffer[1] - '0');
 
-    char address_str[buffer_size];
-    inet_ntop(AF_INET, &sender_input.sin_addr, address_str, buffer_size);
+    const std::size_t sites_amount = sizeof(command_allocation_sites) / sizeof(command_allocation_sites[0]);
+    AllocationSite allocation_site(header.command < sites_amount ? command_allocation_sites[header.command] : "UNKNOWN_COMMAND");
 
     Sender sender;
-    sender.SetIpAddress(address_str);
+    sender.SetAddress(sender_input.sin_addr.s_addr);
     sender.SetterPort(ntohs(sender_input.sin_port));
 
-    if (header.command >= 0 || header.command < commandFunctions.size())
+    if (header.command != Command::JOIN && !this->ResolveSession(buffer, len, sender))
+    {
+        std::cout << "Invalid session token from [" << sender.GetIpAddress() << ":" << sender.GetPort() << "]\n";
+        return;
+    }
+
+    // Any packet can carry an acknowledgement into "rid" (piggybacked on moves, or the explicit "ACK" command).
+    if (header.rid != 0)
+    {
+        Command acknowledged_command;
+        std::int64_t round_trip_us;
+
+        auto reliable_peer = this->reliable_peers.find(sender);
+        if (reliable_peer != this->reliable_peers.end() && reliable_peer->second.Acknowledge(header.rid, std::chrono::steady_clock::now(), &acknowledged_command, &round_trip_us))
+        {
+            // Move round trip: from the field update sent after a move to its acknowledgement.
+            if (acknowledged_command == Command::UPDATE_FIELD && round_trip_us >= 0) this->move_round_trip_us.Record(round_trip_us);
+
+            this->acknowledgements_amount++;
+            this->ReleaseIdlePeer(sender);
+        }
+    }
+
+    if (this->commandFunctions.find(header.command) != this->commandFunctions.end())
     {
         this->commandFunctions[header.command](buffer, sender, len);
         return;
@@ -233,12 +576,7 @@ void Server::SendAnnounce(const Sender& sender)
         std::string announce_info(std::to_string(announce.header.rid) + std::to_string(static_cast<std::uint32_t>(announce.header.command)) + Utility::GetParsedRoomIDLength(room_id_str, room_id_str.length()) + room_id_str);
         const char* announce_packet = announce_info.c_str();
 
-        sockaddr_in sender_in;
-        sender_in.sin_family = AF_INET;
-        inet_pton(AF_INET, sender.GetIpAddress().c_str(), &sender_in.sin_addr);
-        sender_in.sin_port = htons(sender.GetPort());
-
-        int sent_bytes = sendto(this->socket_id, announce_packet, strlen(announce_packet), 0, reinterpret_cast<sockaddr*>(&sender_in), sizeof(sender_in));
+        this->SendPacket(announce_packet, strlen(announce_packet), sender); // A lost announce is sent again by the next fan-out.
     }
 }
 
@@ -247,54 +585,68 @@ void Server::Announces(const int room_id, const bool to_remove)
     if (to_remove) this->opened_rooms.erase(room_id);
     else this->opened_rooms.insert(room_id);
 
-    if (this->opened_rooms.size() <= 0) return;
-
-    for (auto& sender : this->players)
+    // Every fan-out sends all the opened rooms: the deferred ones collapse into the last.
+    if (this->overloaded || this->shedding)
     {
-        const Player& current_player = sender.second;
-        int local_room_id = current_player.GetCurrentRoom().first;
-        if (local_room_id > 0) continue;
-
-        this->SendAnnounce(sender.first);
+        this->DeferAnnounces();
+        return;
     }
+
+    this->announces_deferred = false;
+    this->SendAnnounces();
 }
 
-void Server::StartGame(const Room& room) const
+void Server::DeferAnnounces()
 {
-    Player& owner = *room.GetOwner();
-    Player& challenger = *room.GetChallenger();
+    if (!this->announces_deferred) this->announces_deferred_since_ms = Clock::GetNowMilliseconds();
+    this->announces_deferred = true;
+    this->deferred_announces_amount++;
+}
 
-    header_t header;
-    header.rid = 0;
-    header.command = Command::START_GAME;
+void Server::FlushDeferredAnnounces()
+{
+    // Shedding: held back until the load is gone, whatever the deferral.
+    if (!this->announces_deferred || this->shedding) return;
+    if (this->overloaded && Clock::GetNowMilliseconds() - this->announces_deferred_since_ms < announce_max_deferral_ms) return;
 
-    for (auto& sender : this->players)
-    {
-        const Player& current_player = sender.second;
+    this->announces_deferred = false;
+    this->SendAnnounces();
+}
 
-        if (current_player.GetCurrentRoom().first == owner.GetCurrentRoom().first || current_player.GetCurrentRoom().first == challenger.GetCurrentRoom().first)
-        {
-            sockaddr_in sender_in;
-            sender_in.sin_family = AF_INET;
-            inet_pton(AF_INET, sender.first.GetIpAddress().c_str(), &sender_in.sin_addr);
-            sender_in.sin_port = htons(sender.first.GetPort());
+void Server::SendAnnounces()
+{
+    if (this->opened_rooms.size() <= 0) return;
 
-            std::string start_game_info(std::to_string(header.rid) + std::to_string(static_cast<std::uint32_t>(header.command)));
-            const char* start_game_packet = start_game_info.c_str();
+    for (const session_t& session : this->sessions)
+    {
+        const Player& current_player = session.second;
+        if (current_player.GetPlayerID() == 0) continue; // Free slot.
 
-            int sent_bytes = sendto(this->socket_id, start_game_packet, strlen(start_game_packet), 0, reinterpret_cast<struct sockaddr*>(&sender_in), sizeof(sender_in));
-        }
+        int local_room_id = current_player.GetCurrentRoom().first;
+        if (local_room_id > 0) continue;
+        if (this->spectating.count(session.first) > 0) continue;
+
+        this->SendAnnounce(session.first);
     }
 }
 
+void Server::StartGame(const Room& room)
+{
+    this->Broadcast(room, PacketBuffer::GetStatic(Command::START_GAME));
+}
+
 void Server::CheckDeadPeers()
 {
+    AllocationSite allocation_site("CheckDeadPeers");
+
     std::vector<Sender> dead_players;
-    const std::size_t now = Utility::GetNowTime();
+    const std::size_t now = Clock::GetNowMilliseconds();
 
-    for (auto& player : players) 
+    for (const session_t& player : this->sessions) 
     {
-        Player& current_player = player.second;
+        const Player& current_player = player.second;
+        if (current_player.GetPlayerID() == 0) continue; // Free slot.
+
         const int current_room_id = current_player.GetCurrentRoom().first;
 
         if (current_room_id > 0)
@@ -303,7 +655,7 @@ void Server::CheckDeadPeers()
 
             if (!current_room.IsDoorOpen())
             {
-                if ((now - current_player.GetLastPacketTimeStamp()) > in_game_timeout_seconds)
+                if ((now - current_player.GetLastPacketTimeStamp()) > in_game_timeout_seconds * 1000)
                 {
                     dead_players.push_back(player.first);
                     continue;
@@ -311,7 +663,7 @@ void Server::CheckDeadPeers()
             }
         }
 
-        if ((now - current_player.GetLastPacketTimeStamp()) > timeout_seconds)
+        if ((now - current_player.GetLastPacketTimeStamp()) > timeout_seconds * 1000)
         {
             dead_players.push_back(player.first);
         }
@@ -325,273 +677,1980 @@ void Server::CheckDeadPeers()
 
 void Server::CheckEndedChallenges()
 {
+    AllocationSite allocation_site("CheckEndedChallenges");
+
+    const std::size_t now = Clock::GetNowMilliseconds();
+
     for (auto& room : this->rooms)
     {
         if (room.second.IsDraw() || room.second.GetWinner())
         {
-            if ((Utility::GetNowTime() - room.second.GetEndedChallengeTimestamp()) > reset_field_time)
+            if ((now - room.second.GetEndedChallengeTimestamp()) > reset_field_time * 1000)
             {
                 room.second.Reset(false);
+                this->PrintTurn(room.second);
+                this->JournalRoom(room.second);
                 this->UpdateField(room.second);
             }
         }
     }
 }
 
-void Server::Run()
+int Server::SendPacket(const char* packet, const int packet_len, const Sender& sender)
 {
-    for (;;)
-    {
-        this->Tick();
-        this->CheckEndedChallenges();
-        this->CheckDeadPeers();
-    }
+    // Replayed traffic must never reach the (real) endpoints stored into the capture.
+    if (this->replaying || this->socket_id < 0) return packet_len;
+
+    if (this->QueueOutbound(packet, packet_len, sender)) return packet_len;
+    return this->SendDatagram(packet, packet_len, sender);
 }
 
-void Server::UpdateField(const Room& room) const
+int Server::SendDatagram(const char* packet, const int packet_len, const Sender& sender) const
 {
-    Player& owner = *room.GetOwner();
-    Player& challenger = *room.GetChallenger();
+    sockaddr_in sender_in;
+    sender_in.sin_family = AF_INET;
+    sender_in.sin_addr.s_addr = sender.GetAddress();
+    sender_in.sin_port = htons(sender.GetPort());
 
-    header_t header;
-    header.rid = 0;
-    header.command = Command::UPDATE_FIELD;
+    return sendto(this->socket_id, packet, packet_len, 0, reinterpret_cast<sockaddr*>(&sender_in), sizeof(sender_in));
+}
 
-    for (auto& sender : this->players)
-    {
-        const Player& current_player = sender.second;
+int Server::SendPacket(const PacketBuffer& packet, const std::uint32_t sequence, const Sender& sender)
+{
+    // The shared bytes stay untouched: the header is stamped into a copy on the stack.
+    char stamped_packet[packet_buffer_capacity];
+    std::memcpy(stamped_packet, packet.GetData(), packet.GetSize());
+    stamped_packet[0] = static_cast<char>('0' + sequence);
 
-        if (current_player.GetCurrentRoom().first == owner.GetCurrentRoom().first || current_player.GetCurrentRoom().first == challenger.GetCurrentRoom().first)
-        {
-            sockaddr_in sender_in;
-            sender_in.sin_family = AF_INET;
-            inet_pton(AF_INET, sender.first.GetIpAddress().c_str(), &sender_in.sin_addr);
-            sender_in.sin_port = htons(sender.first.GetPort());
+    return this->SendPacket(stamped_packet, static_cast<int>(packet.GetSize()), sender);
+}
 
-            std::string updated_field = { room.ParseSymbol(0), room.ParseSymbol(1), room.ParseSymbol(2), room.ParseSymbol(3), room.ParseSymbol(4), room.ParseSymbol(5), room.ParseSymbol(6), room.ParseSymbol(7), room.ParseSymbol(8) };
+bool Server::QueueOutbound(const char* packet, const int packet_len, const Sender& sender)
+{
+    // Only sessions get a frame: e.g. the kick of an unknown endpoint is sent right away.
+    const session_t* session = this->FindSession(sender);
+    if (!session || packet_len <= 0 || static_cast<std::size_t>(packet_len) > outbound_message_max_size) return false;
 
-            std::string update_field_info(std::to_string(header.rid) + std::to_string(static_cast<std::uint32_t>(header.command)) + updated_field);
-            const char* update_field_packet = update_field_info.c_str();
+    const std::uint32_t player_id = session->second.GetPlayerID();
+    if (player_id >= this->outbound_slots.size()) this->outbound_slots.resize(player_id + 1, 0);
 
-            int sent_bytes = sendto(this->socket_id, update_field_packet, strlen(update_field_packet), 0, reinterpret_cast<sockaddr*>(&sender_in), sizeof(sender_in));
-        }
+    // The slot may still point to the frame of a released session whose ID was reused within the tick.
+    std::uint32_t& slot = this->outbound_slots[player_id];
+    if (slot == 0 || !(this->outbound_frames[slot - 1].sender == sender))
+    {
+        this->outbound_frames.emplace_back();
+        slot = static_cast<std::uint32_t>(this->outbound_frames.size());
+
+        outbound_frame_t& new_frame = this->outbound_frames.back();
+        new_frame.sender = sender;
+        new_frame.player_id = player_id;
+        new_frame.messages_amount = 0;
+        new_frame.size = header_bytes_amount;
+        std::memcpy(new_frame.data.data(), PacketBuffer::GetStatic(Command::FRAME).GetData(), header_bytes_amount);
     }
+
+    outbound_frame_t& frame = this->outbound_frames[slot - 1];
+    if (frame.size + 1 + packet_len > outbound_frame_size) this->SendFrame(frame); // Full: the older packets go first.
+
+    frame.data[frame.size] = static_cast<char>(packet_len);
+    std::memcpy(frame.data.data() + frame.size + 1, packet, packet_len);
+    frame.size += 1 + packet_len;
+    frame.messages_amount++;
+
+    return true;
 }
 
-void TTTServer::Server::ResetClient(const Room& room) const
+void Server::SendFrame(outbound_frame_t& frame)
 {
-    Player owner, challenger;
+    if (frame.messages_amount == 0) return;
 
-    if (room.GetOwner()) owner = *room.GetOwner();
-    if (room.GetChallenger()) challenger = *room.GetChallenger();
+    // A lone packet doesn't need the frame: it goes out without the header and its length.
+    if (frame.messages_amount == 1) this->SendDatagram(frame.data.data() + header_bytes_amount + 1, static_cast<int>(frame.size - header_bytes_amount - 1), frame.sender);
+    else this->SendDatagram(frame.data.data(), static_cast<int>(frame.size), frame.sender);
 
-    header_t header;
-    header.rid = 0;
-    header.command = Command::RESET_CLIENT;
-
-    for (auto& sender : this->players)
-    {
-        const Player& current_player = sender.second;
+    this->outbound_datagrams_amount++;
+    this->outbound_messages_amount += frame.messages_amount;
 
-        if (current_player.GetCurrentRoom().first == owner.GetCurrentRoom().first || current_player.GetCurrentRoom().first == challenger.GetCurrentRoom().first)
-        {
-            sockaddr_in sender_in;
-            sender_in.sin_family = AF_INET;
-            inet_pton(AF_INET, sender.first.GetIpAddress().c_str(), &sender_in.sin_addr);
-            sender_in.sin_port = htons(sender.first.GetPort());
+    frame.messages_amount = 0;
+    frame.size = header_bytes_amount;
+}
 
-            std::string reset_client_info("0" + std::to_string(static_cast<int>(header.command)));
-            const char* reset_client_packet = reset_client_info.c_str();
+void Server::FlushOutbound()
+{
+    AllocationSite allocation_site("FlushOutbound");
 
-            int sent_bytes = sendto(this->socket_id, reset_client_packet, strlen(reset_client_packet), 0, reinterpret_cast<sockaddr*>(&sender_in), sizeof(sender_in));
-        }
+    for (outbound_frame_t& frame : this->outbound_frames)
+    {
+        this->SendFrame(frame);
+        this->outbound_slots[frame.player_id] = 0;
     }
 
+    this->outbound_frames.clear();
 }
 
-// ----------------------------------------------------------------------------------------------
-
-void Server::JoinCommand(char* buffer, Sender& sender, const int len)
+void Server::SendReliable(const PacketBuffer& packet, const Sender& sender)
 {
-    if (len != (player_name_bytes_amount + header_bytes_amount)) return;
+    // Replayed traffic can't be acknowledged: no state to track.
+    if (this->replaying || this->socket_id < 0 || !TTTServer::IsReliableCommand(packet.GetCommand()))
+    {
+        this->SendPacket(packet.GetData(), packet.GetSize(), sender);
+        return;
+    }
 
-    if (this->players.count(sender) > 0)
+    auto peer = this->reliable_peers.find(sender);
+    if (peer == this->reliable_peers.end())
     {
-        std::cout << "[" << sender.GetIpAddress() << ":" << sender.GetPort() << "] has already joined!\n";
-        this->Kick(sender);
+        const session_t* session = this->FindSession(sender);
+        const std::uint32_t player_id = session ? session->second.GetPlayerID() : 0;
+        const std::uint32_t next_sequence = player_id < this->reliable_sequences.size() ? this->reliable_sequences[player_id] : 1;
 
-        return;
+        peer = this->reliable_peers.emplace(sender, ReliablePeer(next_sequence)).first;
     }
 
-    char player_name[player_name_bytes_amount];
-    std::memcpy(player_name, &buffer[header_bytes_amount], player_name_bytes_amount);
+    ReliablePeer& reliable_peer = peer->second;
+    const std::uint32_t sequence = reliable_peer.Track(packet, std::chrono::steady_clock::now());
 
-    Player player = Player(std::string(player_name));
-    this->players[sender] = player;
-    player.SetLastPacketTimeStamp();
-    
-    std::cout << "Player \"" << player.GetName() << "\" joined from [" << sender.GetIpAddress() << ":" << sender.GetPort() << "] | {" << this->players.size() << " players on server}\n";
+    // The client drops what it sees as an old sequence number: a recovered server must go on from here.
+    this->JournalReliableSequence(sender, reliable_peer.GetNextSequence());
 
-    this->SendAnnounce(sender);
+    this->retransmission_timers.push({ reliable_peer.GetDeadline(sequence), sender, sequence });
+    this->SendPacket(packet, sequence, sender);
 }
 
-void Server::CreateRoomCommand(char* buffer, Sender& sender, const int len)
+void Server::CheckRetransmissions()
 {
-    if (this->players.find(sender) != this->players.end())
-    {
-        Player& current_player = this->players.find(sender)->second;
-        int current_room_id = current_player.GetCurrentRoom().first; 
+    AllocationSite allocation_site("CheckRetransmissions");
 
-        if (current_room_id > 0)
-        {
-            std::cout << "Player [" << sender.GetIpAddress() << ":" << sender.GetPort() << "] \"" << current_player.GetName() << "\" already has a room!\n"; 
-            return;
-        }   
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
 
-        std::pair<int, bool> new_room_info = { this->room_counter, true };
-        current_player.SetCurrentRoom(new_room_info);
-        current_player.SetLastPacketTimeStamp();
+    while (!this->retransmission_timers.empty() && this->retransmission_timers.top().deadline <= now)
+    {
+        const retransmission_timer_t timer = this->retransmission_timers.top();
+        this->retransmission_timers.pop();
 
-        Room new_room(this->room_counter, current_player);
-        this->rooms[this->room_counter] = new_room;
-        this->Announces(this->room_counter, false);  
+        auto reliable_peer = this->reliable_peers.find(timer.sender);
+        if (reliable_peer == this->reliable_peers.end()) continue;
 
-        std::cout << "Room with ID: " << this->room_counter << " for player [" << sender.GetIpAddress() << ":" << sender.GetPort() << "] \"" << current_player.GetName() << "\" created!\n";
-        this->room_counter++;
+        bool gave_up;
+        const PacketBuffer* packet = reliable_peer->second.Retransmit(timer.sequence, timer.deadline, now, gave_up);
+        if (gave_up)
+        {
+            this->give_ups_amount++;
+            this->ReleaseIdlePeer(timer.sender);
+        }
+        if (!packet) continue;
 
-        return;
-    }   
+        this->SendPacket(*packet, timer.sequence, timer.sender);
+        this->retransmissions_amount++;
 
-    std::cout << "Unknown player from [" << sender.GetIpAddress() << ":" << sender.GetPort() << "]\n";
+        this->retransmission_timers.push({ reliable_peer->second.GetDeadline(timer.sequence), timer.sender, timer.sequence });
+    }
 }
 
-void Server::ChallengeCommand(char* buffer, Sender& sender, const int len)
+void Server::ReleaseIdlePeer(const Sender& sender)
 {
-    if (len < (header_bytes_amount + room_id_len)) return;
-
-    if (this->players.find(sender) != this->players.end())
-    {
-        Player& current_player = this->players.find(sender)->second;
+    auto reliable_peer = this->reliable_peers.find(sender);
+    if (reliable_peer == this->reliable_peers.end() || !reliable_peer->second.IsIdle()) return;
 
-        int current_room_id = current_player.GetCurrentRoom().first;
-        if (current_room_id > 0)
-        {
-            std::cout << "Player [" << sender.GetIpAddress() << ":" << sender.GetPort() << "] \"" << current_player.GetName() << "\" already in a room!\n"; 
-            return;
-        }          
+    // Players in a room keep their peer (and its RTT estimate) for the next moves.
+    const session_t* session = this->FindSession(sender);
+    if (!session || session->second.GetCurrentRoom().first > 0) return;
 
-        std::string room_id_length_str;
-        std::memcpy(&room_id_length_str, &buffer[header_bytes_amount], room_id_len);
-        const std::uint32_t room_id_length = std::stoull(room_id_length_str);  
+    const std::uint32_t player_id = session->second.GetPlayerID();
+    if (player_id >= this->reliable_sequences.size()) this->reliable_sequences.resize(player_id + 1, 1);
+    this->reliable_sequences[player_id] = static_cast<std::uint8_t>(reliable_peer->second.GetNextSequence());
 
-        std::string room_id_bytes;
-        std::memcpy(&room_id_bytes, &buffer[header_bytes_amount + room_id_len], room_id_length);
-        int room_id = std::stoi(room_id_bytes);    
+    this->reliable_peers.erase(reliable_peer);
+}
 
-        if (this->rooms.find(room_id) == this->rooms.end()) // Iterator check.
-        {
-            std::cout << "Unknown room with ID: " << room_id << "!\n";
-            return;
-        }         
+std::uint32_t Server::GetReliableSequence(const session_t& session) const
+{
+    auto reliable_peer = this->reliable_peers.find(session.first);
+    if (reliable_peer != this->reliable_peers.end()) return reliable_peer->second.GetNextSequence();
 
-        Room& room = this->rooms[room_id];   
-        if (!room.IsDoorOpen())
-        {
-            std::cout << "Room with ID: " << room.GetRoomID() << " is closed!\n";
-            return;
-        }       
+    const std::uint32_t player_id = session.second.GetPlayerID();
+    return player_id < this->reliable_sequences.size() ? this->reliable_sequences[player_id] : 1;
+}
 
-        std::pair<int, bool> room_info = { room.GetRoomID(), false };
-        current_player.SetCurrentRoom(room_info);
-        room.SetChallenger(std::make_shared<Player>(current_player));   
+void Server::RestoreReliableSequence(const std::uint32_t player_id, const std::uint32_t next_sequence)
+{
+    if (player_id >= this->reliable_sequences.size()) this->reliable_sequences.resize(player_id + 1, 1);
+    this->reliable_sequences[player_id] = static_cast<std::uint8_t>(next_sequence);
+}
 
-        current_player.SetLastPacketTimeStamp();
-        
-        // Bad code, i know.
-        for (auto& player : this->players)
-        {
-            if (player.second == *room.GetOwner())
-            {
-                player.second.SetLastPacketTimeStamp();
-            }
-        }
+int Server::GetReceiveWait() const
+{
+    if (!this->pending_spectator_broadcasts.empty() || this->lobby_lane.size > 0 || this->snapshot_build.active) return 0;
+    if (this->retransmission_timers.empty()) return this->receive_timeout_ms;
 
-        std::cout << "Game on room with ID: " << room.GetRoomID() << " started!\n";
+    const std::chrono::steady_clock::duration until_deadline = this->retransmission_timers.top().deadline - std::chrono::steady_clock::now();
+    const std::int64_t wait_ms = std::chrono::duration_cast<std::chrono::milliseconds>(until_deadline).count() + 1;
 
-        this->Announces(room.GetRoomID(), true);
-            
-        room.Reset(false);
-        this->StartGame(room);
+    return static_cast<int>(std::clamp<std::int64_t>(wait_ms, 0, this->receive_timeout_ms));
+}
 
-        return;
+void Server::ReleaseSender(const Sender& sender)
+{
+    auto player = this->players.find(sender);
+    if (player != this->players.end())
+    {
+        const std::uint32_t player_id = player->second;
+        if (this->dispatched_session == &this->sessions[player_id]) this->dispatched_session = nullptr;
+
+        // A new generation: the tokens issued for this slot are no longer valid.
+        this->RemoveSession(player_id);
+        this->session_tokens[player_id] = 0;
+        this->session_generations[player_id]++;
+        this->players.erase(player);
+    }
+
+    this->LeaveQuickMatch(sender);
+    this->LeaveSpectating(sender);
+    this->reliable_peers.erase(sender);
+}
+
+void Server::StartCapture(const std::string& path)
+{
+    try
+    {
+        // A capture is replayable only with a seeded generator: without "--seed" one is picked here, before the first draw.
+        capture_header_t header;
+        if (!Random::GetSeed(header.random_seed))
+        {
+            std::random_device random_device;
+            header.random_seed = (static_cast<std::uint64_t>(random_device()) << 32) | random_device();
+            Random::SetSeed(header.random_seed);
+        }
+
+        header.start_milliseconds = Clock::Update();
+        header.session_token_key[0] = this->session_token_key[0];
+        header.session_token_key[1] = this->session_token_key[1];
+        header.join_cookies = this->join_cookies;
+        header.join_cookie_key[0] = this->join_cookie_key[0];
+        header.join_cookie_key[1] = this->join_cookie_key[1];
+
+        this->capture = std::make_unique<PacketCapture>(path, header);
+        std::cout << "Capturing inbound packets into \"" << path << "\"\n";
+    }
+    catch (const NetworkException& exception)
+    {
+        std::cout << exception.what() << "\n";
+    }
+}
+
+void Server::Replay(const std::string& path, const bool at_recorded_speed)
+{
+    try
+    {
+        PacketReplay replay(path);
+
+        // The secrets of the recording server: tokens and cookies are checked exactly as they were.
+        const capture_header_t& header = replay.GetHeader();
+        Random::SetSeed(header.random_seed);
+        this->session_token_key[0] = header.session_token_key[0];
+        this->session_token_key[1] = header.session_token_key[1];
+        this->join_cookies = header.join_cookies;
+        this->join_cookie_key[0] = header.join_cookie_key[0];
+        this->join_cookie_key[1] = header.join_cookie_key[1];
+
+        capture_record_t record;
+        char buffer[buffer_size];
+        std::size_t packets_amount = 0;
+
+        this->replaying = true;
+        const std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+
+        // The server sees the recorded time, also when replaying as fast as possible (timeouts and cookie slots included).
+        const std::uint64_t replay_start_ms = header.start_milliseconds;
+        Clock::EnableVirtualTime(replay_start_ms);
+
+        while (replay.Next(record, buffer, buffer_size))
+        {
+            if (at_recorded_speed)
+            {
+                std::this_thread::sleep_until(start_time + std::chrono::nanoseconds(record.timestamp_ns));
+            }
+
+            const std::uint64_t record_ms = replay_start_ms + record.timestamp_ns / 1000000;
+            if (record_ms > Clock::GetNowMilliseconds()) Clock::Advance(record_ms - Clock::GetNowMilliseconds());
+
+            sockaddr_in sender_input;
+            sender_input.sin_family = AF_INET;
+            sender_input.sin_addr.s_addr = record.address;
+            sender_input.sin_port = htons(record.port);
+
+            // Same steps of "Run", with the socket read replaced by the capture read.
+            this->Dispatch(buffer, record.length, sender_input);
+            this->CheckEndedChallenges();
+            this->CheckDeadPeers();
+            this->FlushSpectatorBroadcasts();
+
+            packets_amount++;
+        }
+
+        this->replaying = false;
+        Clock::DisableVirtualTime();
+
+        const double elapsed_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+        std::cout << "Replayed " << packets_amount << " packets in " << elapsed_seconds << " s (" << (elapsed_seconds > 0 ? packets_amount / elapsed_seconds : 0) << " packets/s)\n";
+    }
+    catch (const NetworkException& exception)
+    {
+        this->replaying = false;
+        Clock::DisableVirtualTime();
+        std::cout << exception.what() << "\n";
+    }
+}
+
+void Server::Run()
+{
+    while (this->running)
+    {
+        const std::uint64_t allocations_before = AllocationTracker::GetAllocationsAmount();
+
+        this->Tick();
+        this->CheckEndedChallenges();
+        this->CheckDeadPeers();
+        this->FlushSpectatorBroadcasts();
+        this->CheckRetransmissions();
+        this->CheckSnapshot();
+        this->CheckHandoff();
+        this->CheckMetrics();
+        this->FlushDeferredAnnounces();
+        this->FlushOutbound();
+
+        // The replies of the dispatched datagrams (if any) are gone: end of their service.
+        if (this->dispatched_amount > 0)
+        {
+            const std::uint64_t send_timestamp_ns = ReadWallClockNanoseconds();
+            for (std::size_t i = 0; i < this->dispatched_amount; i++)
+            {
+                if (send_timestamp_ns > this->dispatch_timestamps_ns[i]) this->service_time_us.Record((send_timestamp_ns - this->dispatch_timestamps_ns[i]) / 1000);
+            }
+
+            this->dispatched_amount = 0;
+            this->CheckShedding(send_timestamp_ns);
+        }
+
+        this->allocations_per_tick.Record(AllocationTracker::GetAllocationsAmount() - allocations_before);
+    }
+}
+
+void Server::UpdateField(const Room& room)
+{
+    this->Broadcast(room, PacketBuffer::Encode(Command::UPDATE_FIELD, room.GetFieldSymbols()));
+}
+
+void TTTServer::Server::ResetClient(const Room& room)
+{
+    this->Broadcast(room, PacketBuffer::GetStatic(Command::RESET_CLIENT));
+}
+
+void Server::Broadcast(const Room& room, const PacketBuffer& packet)
+{
+    for (const std::uint32_t seat : { room.GetOwner(), room.GetChallenger() })
+    {
+        const session_t* session = this->GetSession(seat);
+        if (!session) continue;
+
+        this->SendReliable(packet, session->first);
+    }
+
+    this->BroadcastToSpectators(room.GetRoomID(), packet);
+}
+
+void Server::PrintTurn(const Room& room)
+{
+    const session_t* session = this->GetSession(room.GetTurnOf());
+    if (session) std::cout << "Turn of \"" << session->second.GetName() << "\"!\n";
+}
+
+// ----------------------------------------------------------------------------------------------
+
+Server::session_t* Server::AddPlayer(const Sender& sender, const Player& player)
+{
+    const std::uint32_t player_id = player.GetPlayerID();
+    this->players.insert_or_assign(sender, player_id);
+
+    if (player_id >= this->sessions.size()) this->sessions.resize(player_id + 1);
+
+    // The index views the stored name: it leaves before the name changes.
+    session_t& session = this->sessions[player_id];
+    if (session.second.GetPlayerID() == player_id) this->player_registry.RemoveName(session.second.GetName(), player_id);
+
+    session = { sender, player };
+    this->player_registry.AddName(session.second.GetName(), player_id);
+
+    return &session;
+}
+
+void Server::RemoveSession(const std::uint32_t player_id)
+{
+    session_t* session = this->GetSession(player_id);
+    if (!session) return;
+
+    this->player_registry.RemoveName(session->second.GetName(), player_id);
+    this->player_registry.Release(player_id);
+    *session = session_t();
+}
+
+Server::session_t* Server::GetSession(const std::uint32_t player_id)
+{
+    if (player_id == 0 || player_id >= this->sessions.size()) return nullptr;
+
+    session_t& session = this->sessions[player_id];
+    return session.second.GetPlayerID() == player_id ? &session : nullptr;
+}
+
+Server::session_t* Server::FindSession(const Sender& sender)
+{
+    auto player = this->players.find(sender);
+    return player != this->players.end() ? &this->sessions[player->second] : nullptr;
+}
+
+void Server::EnableJoinCookies()
+{
+    // Never from the seeded generator ("--seed"): a predictable key would let anybody forge cookies.
+    std::random_device random_device;
+    for (std::uint64_t& key : this->join_cookie_key)
+    {
+        key = (static_cast<std::uint64_t>(random_device()) << 32) | random_device();
+    }
+
+    this->join_cookies = true;
+}
+
+void Server::EnableFloodDefense(const std::uint32_t packets_per_second)
+{
+    this->heavy_hitters.SetThreshold(packets_per_second);
+}
+
+void Server::SetCapacity(const std::size_t max_players, const std::size_t max_rooms, const std::size_t shed_latency_ms)
+{
+    this->max_players = max_players;
+    this->max_rooms = max_rooms;
+    this->shed_latency_us = static_cast<std::int64_t>(shed_latency_ms * 1000);
+}
+
+void Server::CheckShedding(const std::uint64_t tick_end_ns)
+{
+    if (tick_end_ns <= this->tick_start_ns) return;
+
+    const std::int64_t work_us = static_cast<std::int64_t>((tick_end_ns - this->tick_start_ns) / 1000);
+    this->tick_work_us.Record(work_us);
+    this->tick_work_average_us += (work_us - this->tick_work_average_us) / tick_work_smoothing;
+
+    if (this->shed_latency_us == 0) return;
+
+    // Hysteresis: it starts past the threshold and stops under its half, instead of flapping around it.
+    if (!this->shedding && this->tick_work_average_us > this->shed_latency_us)
+    {
+        this->shedding = true;
+        this->shed_episodes_amount++;
+        std::cout << "WARNING: " << this->tick_work_average_us << " us of work per tick, shedding the non essential work!\n";
+    }
+    else if (this->shedding && this->tick_work_average_us < this->shed_latency_us / 2)
+    {
+        this->shedding = false;
+        std::cout << "Work per tick back to " << this->tick_work_average_us << " us: shedding stopped\n";
+    }
+}
+
+std::uint64_t Server::ComputeJoinCookie(const Sender& sender, const std::uint64_t slot) const
+{
+    const std::uint32_t address = sender.GetAddress();
+
+    char input[sizeof(std::uint32_t) + sizeof(std::uint16_t) + sizeof(std::uint64_t)];
+    std::memcpy(input, &address, sizeof(std::uint32_t));
+    Utility::WriteLittleEndian(&input[sizeof(std::uint32_t)], sender.GetPort(), sizeof(std::uint16_t));
+    Utility::WriteLittleEndian(&input[sizeof(std::uint32_t) + sizeof(std::uint16_t)], slot, sizeof(std::uint64_t));
+
+    const std::uint64_t mac = Utility::SipHash(this->join_cookie_key[0], this->join_cookie_key[1], input, sizeof(input));
+    return (mac & ~static_cast<std::uint64_t>(0xFF)) | (slot & 0xFF);
+}
+
+bool Server::CheckJoinCookie(const char* cookie, const Sender& sender) const
+{
+    const std::uint64_t value = Utility::ReadLittleEndian(cookie, join_cookie_bytes_amount);
+    const std::uint64_t slot = Clock::GetNowMilliseconds() / (join_cookie_slot_seconds * 1000);
+
+    // The low byte tells the slot (the current one or the previous one): a single hash to compute.
+    std::uint64_t cookie_slot;
+    if ((value & 0xFF) == (slot & 0xFF)) cookie_slot = slot;
+    else if (slot > 0 && (value & 0xFF) == ((slot - 1) & 0xFF)) cookie_slot = slot - 1;
+    else return false;
+
+    return this->ComputeJoinCookie(sender, cookie_slot) == value;
+}
+
+void Server::SendJoinCookie(const Sender& sender)
+{
+    const std::uint64_t slot = Clock::GetNowMilliseconds() / (join_cookie_slot_seconds * 1000);
+
+    char cookie_packet[header_bytes_amount + join_cookie_bytes_amount];
+    std::memcpy(cookie_packet, PacketBuffer::GetStatic(Command::COOKIE).GetData(), header_bytes_amount);
+    Utility::WriteLittleEndian(&cookie_packet[header_bytes_amount], this->ComputeJoinCookie(sender, slot), join_cookie_bytes_amount);
+
+    this->SendPacket(cookie_packet, sizeof(cookie_packet), sender);
+    this->join_cookies_amount++;
+}
+
+std::uint64_t Server::IssueSessionToken(const std::uint32_t player_id)
+{
+    if (player_id >= this->session_tokens.size())
+    {
+        this->session_tokens.resize(player_id + 1, 0);
+        this->session_generations.resize(player_id + 1, 0);
+    }
+
+    // A new session on the client restarts from sequence 1.
+    if (player_id < this->reliable_sequences.size()) this->reliable_sequences[player_id] = 1;
+
+    // Salt --> MAC of | player_id (4) | generation (1) | tokens issued so far (8) |: never the same twice, never guessable.
+    char input[sizeof(std::uint32_t) + sizeof(std::uint8_t) + sizeof(std::uint64_t)];
+    Utility::WriteLittleEndian(&input[0], player_id, sizeof(std::uint32_t));
+    input[sizeof(std::uint32_t)] = static_cast<char>(this->session_generations[player_id]);
+    Utility::WriteLittleEndian(&input[sizeof(std::uint32_t) + sizeof(std::uint8_t)], this->session_tokens_issued++, sizeof(std::uint64_t));
+
+    const std::uint64_t salt = Utility::SipHash(this->session_token_key[0], this->session_token_key[1], input, sizeof(input)) & 0xFFFFFFFF;
+    this->session_tokens[player_id] = (player_id & 0xFFFFFF) | (static_cast<std::uint64_t>(this->session_generations[player_id]) << 24) | (salt << 32);
+
+    return this->session_tokens[player_id];
+}
+
+bool Server::ResolveSession(char* buffer, int& len, const Sender& sender)
+{
+    if (len < static_cast<int>(header_bytes_amount + session_token_bytes_amount)) return false;
+
+    const std::uint64_t token = Utility::ReadLittleEndian(&buffer[header_bytes_amount], session_token_bytes_amount);
+    const std::uint32_t player_id = token & 0xFFFFFF;
+
+    session_t* session = this->GetSession(player_id);
+    if (!session || token != this->session_tokens[player_id]) return false;
+    if (!(session->first == sender) && !this->RebindSession(session, sender)) return false;
+
+    // The handlers see the usual | header | payload | packet.
+    std::memmove(&buffer[header_bytes_amount], &buffer[header_bytes_amount + session_token_bytes_amount], len - header_bytes_amount - session_token_bytes_amount);
+    len -= session_token_bytes_amount;
+
+    this->dispatched_session = session;
+    return true;
+}
+
+bool Server::RebindSession(session_t*& session, const Sender& sender)
+{
+    if (this->players.count(sender) > 0) return false; // The new endpoint already has its own session.
+
+    const Sender old_sender = session->first;
+    const std::uint32_t player_id = session->second.GetPlayerID();
+
+    // Per-endpoint state that can't follow the player: the queue entry and the spectator slot are dropped.
+    this->LeaveQuickMatch(old_sender);
+    this->LeaveSpectating(old_sender);
+
+    auto reliable_peer = this->reliable_peers.find(old_sender);
+    if (reliable_peer != this->reliable_peers.end())
+    {
+        ReliablePeer peer = reliable_peer->second;
+        this->reliable_peers.erase(reliable_peer);
+        this->reliable_peers[sender] = peer;
+    }
+
+    // The record stays in its slot: only the endpoint changes.
+    this->players.erase(old_sender);
+    this->players[sender] = player_id;
+    session->first = sender;
+
+    this->JournalPlayerRemoval(old_sender);
+    this->JournalPlayer(sender, session->second);
+    this->rebinds_amount++;
+
+    std::cout << "Player \"" << session->second.GetName() << "\" moved from [" << old_sender.GetIpAddress() << ":" << old_sender.GetPort() << "] to [" << sender.GetIpAddress() << ":" << sender.GetPort() << "]\n";
+    return true;
+}
+
+Player* Server::FindPlayer(const Sender& sender)
+{
+    // Fast path: the session already resolved by "Dispatch" through the token.
+    if (this->dispatched_session && this->dispatched_session->first == sender) return &this->dispatched_session->second;
+
+    session_t* session = this->FindSession(sender);
+    return session ? &session->second : nullptr;
+}
+
+// ----------------------------------------------------------------------------------------------
+
+void Server::JoinCommand(char* buffer, Sender& sender, const int len)
+{
+    const int join_len = player_name_bytes_amount + header_bytes_amount;
+    if (len != join_len && len != join_len + static_cast<int>(join_cookie_bytes_amount)) return;
+
+    // Nothing is stored before a valid cookie comes back.
+    if (this->join_cookies && (len == join_len || !this->CheckJoinCookie(&buffer[join_len], sender)))
+    {
+        this->SendJoinCookie(sender);
+        return;
+    }
+
+    if (this->players.count(sender) > 0)
+    {
+        std::cout << "[" << sender.GetIpAddress() << ":" << sender.GetPort() << "] has already joined!\n";
+        this->Kick(sender);
+
+        return;
+    }
+
+    if (!this->AdmitPlayer(sender)) return;
+
+    char player_name[player_name_bytes_amount];
+    std::memcpy(player_name, &buffer[header_bytes_amount], player_name_bytes_amount);
+
+    // The name field is '\0' padded, as the name stored into the session.
+    Player player = Player(this->player_registry.Acquire(), std::string_view(player_name, strnlen(player_name, player_name_bytes_amount)));
+    this->AddPlayer(sender, player);
+
+    char session_token[session_token_bytes_amount];
+    Utility::WriteLittleEndian(session_token, this->IssueSessionToken(player.GetPlayerID()), session_token_bytes_amount);
+    this->SendReliable(PacketBuffer::Encode(Command::SESSION, std::string_view(session_token, session_token_bytes_amount)), sender);
+    this->JournalPlayer(sender, player);
+    
+    std::cout << "Player \"" << player.GetName() << "\" joined from [" << sender.GetIpAddress() << ":" << sender.GetPort() << "] | {" << this->players.size() << " players on server}\n";
+
+    // While shedding the newcomer gets the opened rooms with the fan-out after the recovery.
+    if (this->shedding) this->DeferAnnounces();
+    else this->SendAnnounce(sender);
+}
+
+bool Server::AdmitPlayer(const Sender& sender)
+{
+    if (this->max_players == 0 && !this->shedding && this->waiting_room.empty()) return true;
+
+    const std::uint64_t now_ms = Clock::GetNowMilliseconds();
+
+    // Entries of the admitted waiters and of the ones that stopped sending their JOIN are dropped here.
+    while (!this->waiting_room.empty())
+    {
+        const waiting_entry_t& front_entry = this->waiting_room.front();
+        const auto ticket_it = this->waiting_tickets.find(front_entry.sender);
+        if (ticket_it != this->waiting_tickets.end() && ticket_it->second.ticket == front_entry.ticket)
+        {
+            if (now_ms - ticket_it->second.last_join_ms < waiting_room_timeout_seconds * 1000) break;
+            this->waiting_tickets.erase(ticket_it);
+        }
+
+        this->waiting_room.pop_front();
+    }
+
+    // New sessions are non essential work too: while shedding everybody waits.
+    std::size_t free_slots = 0;
+    if (!this->shedding)
+    {
+        if (this->max_players == 0) free_slots = SIZE_MAX;
+        else if (this->players.size() < this->max_players) free_slots = this->max_players - this->players.size();
+    }
+
+    auto ticket_it = this->waiting_tickets.find(sender);
+    if (ticket_it == this->waiting_tickets.end())
+    {
+        if (this->waiting_room.empty() && free_slots > 0) return true; // Nobody ahead.
+
+        // Stale entries included: the queue never outgrows its capacity.
+        if (this->waiting_room.size() >= waiting_room_capacity)
+        {
+            this->SendWaitingRoomPosition(0, sender);
+            return false;
+        }
+
+        const std::uint64_t ticket = this->next_waiting_ticket++;
+        ticket_it = this->waiting_tickets.emplace(sender, waiting_ticket_t{ ticket, now_ms }).first;
+        this->waiting_room.push_back({ sender, ticket });
+    }
+
+    ticket_it->second.last_join_ms = now_ms;
+
+    // Stale entries in the middle still count: a position is at most a few places too far.
+    const std::uint64_t position = ticket_it->second.ticket - this->waiting_room.front().ticket + 1;
+    if (position <= free_slots)
+    {
+        this->waiting_tickets.erase(ticket_it);
+        this->admissions_amount++;
+        return true;
+    }
+
+    this->SendWaitingRoomPosition(position, sender);
+    return false;
+}
+
+void Server::SendWaitingRoomPosition(const std::uint64_t position, const Sender& sender)
+{
+    std::string waiting_info(Utility::EncodeHeader(0, Command::WAITING_ROOM) + std::to_string(position));
+    this->SendPacket(waiting_info.c_str(), waiting_info.size(), sender); // A lost position is sent again when the client repeats its JOIN.
+}
+
+bool Server::IsRoomLimitReached(const Sender& sender)
+{
+    if (this->max_rooms == 0 || this->rooms.size() < this->max_rooms) return false;
+
+    std::cout << "Room limit reached (" << this->max_rooms << " rooms): no new room for [" << sender.GetIpAddress() << ":" << sender.GetPort() << "]!\n";
+    this->rejected_rooms_amount++;
+
+    return true;
+}
+
+void Server::CreateRoomCommand(char* buffer, Sender& sender, const int len)
+{
+    Player* player = this->FindPlayer(sender);
+    if (player)
+    {
+        Player& current_player = *player;
+        int current_room_id = current_player.GetCurrentRoom().first; 
+
+        if (current_room_id > 0)
+        {
+            std::cout << "Player [" << sender.GetIpAddress() << ":" << sender.GetPort() << "] \"" << current_player.GetName() << "\" already has a room!\n"; 
+            return;
+        }   
+
+        if (this->IsRoomLimitReached(sender)) return;
+
+        this->LeaveQuickMatch(sender);
+        this->LeaveSpectating(sender);
+
+        std::pair<int, bool> new_room_info = { this->room_counter, true };
+        current_player.SetCurrentRoom(new_room_info);
+        current_player.SetLastPacketTimeStamp();
+
+        Room new_room(this->room_counter, current_player.GetPlayerID());
+        this->rooms[this->room_counter] = new_room;
+        this->JournalPlayer(sender, current_player);
+        this->JournalRoom(new_room);
+        this->Announces(this->room_counter, false);  
+
+        std::cout << "Room with ID: " << this->room_counter << " for player [" << sender.GetIpAddress() << ":" << sender.GetPort() << "] \"" << current_player.GetName() << "\" created!\n";
+        this->room_counter++;
+
+        return;
+    }   
+
+    std::cout << "Unknown player from [" << sender.GetIpAddress() << ":" << sender.GetPort() << "]\n";
+}
+
+void Server::ChallengeCommand(char* buffer, Sender& sender, const int len)
+{
+    if (len < (header_bytes_amount + room_id_len)) return;
+
+    Player* player = this->FindPlayer(sender);
+    if (player)
+    {
+        Player& current_player = *player;
+
+        int current_room_id = current_player.GetCurrentRoom().first;
+        if (current_room_id > 0)
+        {
+            std::cout << "Player [" << sender.GetIpAddress() << ":" << sender.GetPort() << "] \"" << current_player.GetName() << "\" already in a room!\n"; 
+            return;
+        }          
+
+        const int room_id = Utility::ParseRoomID(buffer, len, header_bytes_amount, room_id_len);
+
+        if (this->rooms.find(room_id) == this->rooms.end()) // Iterator check.
+        {
+            std::cout << "Unknown room with ID: " << room_id << "!\n";
+            return;
+        }         
+
+        Room& room = this->rooms[room_id];   
+        if (!room.IsDoorOpen())
+        {
+            std::cout << "Room with ID: " << room.GetRoomID() << " is closed!\n";
+            return;
+        }       
+
+        this->EnterRoom(room, sender, current_player);
+
+        return;
     }   
 
-    std::cout << "Unknown player from [" << sender.GetIpAddress() << ":" << sender.GetPort() << "]\n";
+    std::cout << "Unknown player from [" << sender.GetIpAddress() << ":" << sender.GetPort() << "]\n";
+}
+
+void Server::ChallengePlayerCommand(char* buffer, Sender& sender, const int len)
+{
+    if (len <= static_cast<int>(header_bytes_amount) || len > static_cast<int>(header_bytes_amount + player_name_bytes_amount)) return;
+
+    Player* player = this->FindPlayer(sender);
+    if (player)
+    {
+        Player& current_player = *player;
+
+        if (current_player.GetCurrentRoom().first > 0)
+        {
+            std::cout << "Player [" << sender.GetIpAddress() << ":" << sender.GetPort() << "] \"" << current_player.GetName() << "\" already in a room!\n"; 
+            return;
+        }
+
+        const char* owner_name = &buffer[header_bytes_amount];
+        const std::string_view name(owner_name, strnlen(owner_name, len - header_bytes_amount));
+
+        // Name index --> ID --> session: no scan of the players. Names aren't unique: a homonym can't be picked.
+        bool ambiguous = false;
+        session_t* owner = this->GetSession(this->player_registry.FindByName(name, ambiguous));
+        if (!owner)
+        {
+            if (ambiguous) std::cout << "More than one player named \"" << name << "\" to challenge!\n";
+            else std::cout << "Unknown player \"" << name << "\" to challenge!\n";
+            return;
+        }
+
+        const std::pair<int, bool> owner_room = owner->second.GetCurrentRoom();
+        auto room = this->rooms.find(owner_room.first);
+        if (!owner_room.second || room == this->rooms.end() || !room->second.IsDoorOpen())
+        {
+            std::cout << "Player \"" << name << "\" has no open room!\n";
+            return;
+        }
+
+        this->EnterRoom(room->second, sender, current_player);
+
+        return;
+    }
+
+    std::cout << "Unknown player from [" << sender.GetIpAddress() << ":" << sender.GetPort() << "]\n";
+}
+
+void Server::EnterRoom(Room& room, const Sender& sender, Player& player)
+{
+    this->LeaveQuickMatch(sender);
+    this->LeaveSpectating(sender);
+
+    std::pair<int, bool> room_info = { room.GetRoomID(), false };
+    player.SetCurrentRoom(room_info);
+    room.SetChallenger(player.GetPlayerID());   
+
+    player.SetLastPacketTimeStamp();
+
+    session_t* owner = this->GetSession(room.GetOwner());
+    if (owner) owner->second.SetLastPacketTimeStamp();
+
+    std::cout << "Game on room with ID: " << room.GetRoomID() << " started!\n";
+
+    this->Announces(room.GetRoomID(), true);
+        
+    room.Reset(false);
+    this->PrintTurn(room);
+    this->JournalPlayer(sender, player);
+    this->JournalRoom(room);
+    this->StartGame(room);
+}
+
+void Server::MoveCommand(char* buffer, Sender& sender, const int len)
+{
+    if (len != (header_bytes_amount + cell_bytes_amount)) return;
+
+    Player* player = this->FindPlayer(sender);
+    if (player)
+    {
+        Player& current_player = *player;
+
+        int current_room_id = current_player.GetCurrentRoom().first;  
+        if (current_room_id <= 0)
+        {
+            std::cout << "Player [" << sender.GetIpAddress() << ":" << sender.GetPort() << "] \"" << current_player.GetName() << "\" is not in a room!\n"; 
+            return;
+        }   
+
+        char cell_bytes = buffer[header_bytes_amount];
+        const std::uint32_t cell = cell_bytes - '0';
+
+        Room& room = this->rooms[current_room_id];    
+        if (!room.Move(current_player, cell))
+        {
+            std::cout << "Player \"" << current_player.GetName() << "\" did an invalid move!\n";
+            return;
+        }   
+
+        current_player.SetLastPacketTimeStamp(); 
+
+        UpdateField(room);  
+
+        if (room.GetWinner())
+        {
+            std::cout << "Player \"" << current_player.GetName() << "\" WON!\n"; // Only the last move can win.
+            room.SetEndedChallengeTimestamp(Clock::GetNowMilliseconds());
+        }
+        else if (room.IsDraw())
+        {
+            std::cout << "The game is ended in DRAW!\n";
+            room.SetEndedChallengeTimestamp(Clock::GetNowMilliseconds());
+        }
+
+        this->JournalRoom(room);
+
+        return;
+    }   
+
+    std::cout << "Unknown player from [" << sender.GetIpAddress() << ":" << sender.GetPort() << "]\n";
+}
+
+void Server::QuitCommand(char* buffer, Sender& sender, const int len)
+{
+    if (this->FindPlayer(sender))
+    {
+        this->RemovePlayer(sender);
+        return;
+    }   
+
+    std::cout << "Unknown player from [" << sender.GetIpAddress() << ":" << sender.GetPort() << "]\n";
+}
+
+void Server::AckCommand(char* buffer, Sender& sender, const int len)
+{
+    // Nothing to do: "Dispatch" already consumed the acknowledgement carried by "rid".
+}
+
+void Server::PingCommand(char* buffer, Sender& sender, const int len)
+{
+    // Hot path: a single lookup, no log and no journal (timestamps are not part of the persisted state).
+    Player* player = this->FindPlayer(sender);
+    if (!player) return;
+
+    player->SetLastPacketTimeStamp();
+    this->pings_amount++;
+
+    std::string pong_info(Utility::EncodeHeader(0, Command::PONG) + std::to_string(this->GetHeartbeatInterval()));
+    this->SendPacket(pong_info.c_str(), pong_info.size(), sender); // A lost PONG is answered again by the next PING.
+}
+
+std::size_t Server::GetHeartbeatInterval() const
+{
+    const std::size_t interval = (this->players.size() + heartbeats_per_second_budget - 1) / heartbeats_per_second_budget;
+    return std::clamp(interval, min_heartbeat_interval_seconds, max_heartbeat_interval_seconds);
+}
+
+// ----------------------------------------------------------------------------------------------
+
+void Server::QuickMatchCommand(char* buffer, Sender& sender, const int len)
+{
+    Player* player = this->FindPlayer(sender);
+    if (!player)
+    {
+        std::cout << "Unknown player from [" << sender.GetIpAddress() << ":" << sender.GetPort() << "]\n";
+        return;
+    }
+
+    Player& current_player = *player;
+    if (current_player.GetCurrentRoom().first > 0)
+    {
+        std::cout << "Player [" << sender.GetIpAddress() << ":" << sender.GetPort() << "] \"" << current_player.GetName() << "\" already in a room!\n"; 
+        return;
+    }
+
+    if (this->quick_match_tickets.count(sender) > 0) return; // Already waiting.
+    this->LeaveSpectating(sender);
+
+    // Optional rating bucket: "09" --> bucket 0, "09<digit>" --> bucket <digit>.
+    std::size_t bucket = 0;
+    if (len > static_cast<int>(header_bytes_amount))
+    {
+        bucket = static_cast<std::size_t>(buffer[header_bytes_amount] - '0');
+        if (bucket >= quick_match_buckets) return;
+    }
+
+    current_player.SetLastPacketTimeStamp();
+    std::deque<quick_match_entry_t>& queue = this->quick_match_queues[bucket];
+
+    // Entries left behind by players who quit, created a room or challenged someone are dropped here, and so is any
+    // entry whose session is gone (or already in a room) without passing through "LeaveQuickMatch".
+    session_t* waiting_session = nullptr;
+    while (!queue.empty())
+    {
+        const auto ticket_it = this->quick_match_tickets.find(queue.front().sender);
+        const bool has_ticket = ticket_it != this->quick_match_tickets.end() && ticket_it->second == queue.front().ticket;
+
+        waiting_session = has_ticket ? this->FindSession(queue.front().sender) : nullptr;
+        if (waiting_session && waiting_session->second.GetCurrentRoom().first <= 0) break;
+
+        if (has_ticket) this->quick_match_tickets.erase(ticket_it);
+        queue.pop_front();
+        waiting_session = nullptr;
+    }
+
+    if (queue.empty())
+    {
+        const std::uint64_t ticket = this->next_quick_match_ticket++;
+        this->quick_match_tickets[sender] = ticket;
+        queue.push_back({ sender, ticket, std::chrono::steady_clock::now() });
+        return;
+    }
+
+    if (this->IsRoomLimitReached(sender)) return; // The opponent keeps its place.
+
+    const quick_match_entry_t opponent = queue.front();
+    queue.pop_front();
+    this->quick_match_tickets.erase(opponent.sender);
+
+    Player& waiting_player = waiting_session->second;
+
+    // Same room of "CreateRoomCommand" + "ChallengeCommand", but nobody in the lobby is told about it.
+    std::pair<int, bool> owner_room_info = { this->room_counter, true };
+    waiting_player.SetCurrentRoom(owner_room_info);
+    waiting_player.SetLastPacketTimeStamp();
+
+    std::pair<int, bool> challenger_room_info = { this->room_counter, false };
+    current_player.SetCurrentRoom(challenger_room_info);
+
+    Room new_room(this->room_counter, waiting_player.GetPlayerID());
+    new_room.SetChallenger(current_player.GetPlayerID());
+
+    Room& room = this->rooms[this->room_counter];
+    room = new_room;
+    room.Reset(false);
+    this->PrintTurn(room);
+
+    this->JournalPlayer(opponent.sender, waiting_player);
+    this->JournalPlayer(sender, current_player);
+    this->JournalRoom(room);
+
+    this->time_to_match_us.Record(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - opponent.enqueue_time).count());
+
+    std::cout << "Quick match on room with ID: " << this->room_counter << ": \"" << waiting_player.GetName() << "\" vs \"" << current_player.GetName() << "\"!\n";
+    this->room_counter++;
+
+    this->StartGame(room);
+}
+
+void Server::LeaveQuickMatch(const Sender& sender)
+{
+    // The queue entry itself becomes stale and is dropped when it reaches the front.
+    this->quick_match_tickets.erase(sender);
+}
+
+void Server::SpectateCommand(char* buffer, Sender& sender, const int len)
+{
+    Player* player = this->FindPlayer(sender);
+    if (!player)
+    {
+        std::cout << "Unknown player from [" << sender.GetIpAddress() << ":" << sender.GetPort() << "]\n";
+        return;
+    }
+
+    Player& current_player = *player;
+    if (current_player.GetCurrentRoom().first > 0)
+    {
+        std::cout << "Player [" << sender.GetIpAddress() << ":" << sender.GetPort() << "] \"" << current_player.GetName() << "\" already in a room!\n"; 
+        return;
+    }
+
+    const int room_id = Utility::ParseRoomID(buffer, len, header_bytes_amount, room_id_len);
+    auto room_it = this->rooms.find(room_id);
+    if (room_it == this->rooms.end())
+    {
+        std::cout << "Unknown room with ID: " << room_id << "!\n";
+        return;
+    }
+
+    this->LeaveQuickMatch(sender);
+    this->LeaveSpectating(sender);
+    current_player.SetLastPacketTimeStamp();
+
+    spectator_t spectator;
+    spectator.sender = sender;
+    spectator.address.sin_family = AF_INET;
+    spectator.address.sin_addr.s_addr = sender.GetAddress();
+    spectator.address.sin_port = htons(sender.GetPort());
+
+    std::vector<spectator_t>& room_spectators = this->spectators[room_id];
+    this->spectating[sender] = { room_id, room_spectators.size() };
+    room_spectators.push_back(spectator);
+
+    // Late join: the current state only (two packets), never the history of the moves.
+    const Room& room = room_it->second;
+    if (!room.IsDoorOpen())
+    {
+        const PacketBuffer& start_game_packet = PacketBuffer::GetStatic(Command::START_GAME);
+        this->SendBatch(start_game_packet.GetData(), start_game_packet.GetSize(), &spectator, 1);
+
+        const PacketBuffer update_field_packet = PacketBuffer::Encode(Command::UPDATE_FIELD, room.GetFieldSymbols());
+        this->SendBatch(update_field_packet.GetData(), update_field_packet.GetSize(), &spectator, 1);
+    }
+
+    std::cout << "Player \"" << current_player.GetName() << "\" is spectating room with ID: " << room_id << " {" << room_spectators.size() << " spectators}\n";
+}
+
+void Server::LeaveSpectating(const Sender& sender)
+{
+    auto spectating_it = this->spectating.find(sender);
+    if (spectating_it == this->spectating.end()) return;
+
+    const int room_id = spectating_it->second.first;
+    const std::size_t index = spectating_it->second.second;
+    this->spectating.erase(spectating_it);
+
+    // Swap and pop: the last spectator takes the free slot.
+    std::vector<spectator_t>& room_spectators = this->spectators[room_id];
+    if (index + 1 < room_spectators.size())
+    {
+        room_spectators[index] = room_spectators.back();
+        this->spectating[room_spectators[index].sender].second = index;
+    }
+
+    room_spectators.pop_back();
+    if (room_spectators.empty())
+    {
+        this->spectators.erase(room_id); // A pending broadcast with nobody left is dropped by the next flush.
+    }
+}
+
+void Server::DetachSpectators(const int room_id)
+{
+    auto spectators_it = this->spectators.find(room_id);
+    if (spectators_it == this->spectators.end()) return;
+
+    // They go back to be plain lobby players (the RESET_CLIENT of the room is already queued for them).
+    for (const spectator_t& spectator : spectators_it->second)
+    {
+        this->spectating.erase(spectator.sender);
+    }
+
+    // In order, each to the spectators still missing it.
+    for (std::size_t i = 0; i < this->pending_spectator_broadcasts.size(); )
+    {
+        const spectator_broadcast_t& broadcast = this->pending_spectator_broadcasts[i];
+        if (broadcast.room_id != room_id)
+        {
+            i++;
+            continue;
+        }
+
+        const std::size_t next_index = std::min(broadcast.next_index, spectators_it->second.size());
+        this->SendBatch(broadcast.packet.GetData(), broadcast.packet.GetSize(), spectators_it->second.data() + next_index, spectators_it->second.size() - next_index);
+        this->pending_spectator_broadcasts.erase(this->pending_spectator_broadcasts.begin() + i);
+    }
+
+    this->spectators.erase(spectators_it);
+}
+
+void Server::BroadcastToSpectators(const int room_id, const PacketBuffer& packet)
+{
+    if (this->spectators.count(room_id) == 0) return;
+
+    // Only a field update still in flight is replaced by a newer one (it carries the whole field): any other packet
+    // changes the state of the client, so it's queued after the ones of the room that every spectator must get first.
+    spectator_broadcast_t* broadcast = this->FindLastSpectatorBroadcast(room_id);
+    if (broadcast && broadcast->packet.GetCommand() == Command::UPDATE_FIELD && packet.GetCommand() == Command::UPDATE_FIELD)
+    {
+        broadcast->packet = packet;
+        broadcast->next_index = 0;
+        return;
+    }
+
+    this->pending_spectator_broadcasts.emplace_back();
+    broadcast = &this->pending_spectator_broadcasts.back();
+    broadcast->room_id = room_id;
+    broadcast->packet = packet;
+    broadcast->next_index = 0;
+}
+
+Server::spectator_broadcast_t* Server::FindLastSpectatorBroadcast(const int room_id)
+{
+    for (auto broadcast = this->pending_spectator_broadcasts.rbegin(); broadcast != this->pending_spectator_broadcasts.rend(); ++broadcast)
+    {
+        if (broadcast->room_id == room_id) return &*broadcast;
+    }
+
+    return nullptr;
+}
+
+void Server::FlushSpectatorBroadcasts()
+{
+    AllocationSite allocation_site("FlushSpectatorBroadcasts");
+
+    std::size_t budget = spectator_sends_per_tick;
+
+    // First in, first out: an entry is reached only once the older ones are done, so a room gets its packets in order.
+    for (std::size_t i = 0; i < this->pending_spectator_broadcasts.size() && budget > 0; )
+    {
+        spectator_broadcast_t& broadcast = this->pending_spectator_broadcasts[i];
+
+        auto spectators_it = this->spectators.find(broadcast.room_id);
+        const std::size_t spectators_amount = spectators_it != this->spectators.end() ? spectators_it->second.size() : 0;
+
+        const std::size_t recipients_amount = std::min(budget, spectators_amount - std::min(broadcast.next_index, spectators_amount));
+        if (recipients_amount > 0) this->SendBatch(broadcast.packet.GetData(), broadcast.packet.GetSize(), spectators_it->second.data() + broadcast.next_index, recipients_amount);
+
+        broadcast.next_index += recipients_amount;
+        budget -= recipients_amount;
+
+        if (broadcast.next_index >= spectators_amount) this->pending_spectator_broadcasts.erase(this->pending_spectator_broadcasts.begin() + i);
+        else i++;
+    }
+}
+
+std::size_t Server::SendBatch(const char* packet, const int packet_len, const spectator_t* recipients, const std::size_t recipients_amount) const
+{
+    if (this->replaying || this->socket_id < 0) return recipients_amount;
+
+#ifdef __linux__
+    // One "sendmmsg" per batch instead of one "sendto" per spectator.
+    mmsghdr messages[spectator_batch_size];
+    iovec packet_vector = { const_cast<char*>(packet), static_cast<std::size_t>(packet_len) };
+    std::size_t sent_amount = 0;
+
+    for (std::size_t offset = 0; offset < recipients_amount; offset += spectator_batch_size)
+    {
+        const std::size_t batch_size = std::min(spectator_batch_size, recipients_amount - offset);
+        std::memset(messages, 0, sizeof(mmsghdr) * batch_size);
+
+        for (std::size_t i = 0; i < batch_size; i++)
+        {
+            messages[i].msg_hdr.msg_name = const_cast<sockaddr_in*>(&recipients[offset + i].address);
+            messages[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+            messages[i].msg_hdr.msg_iov = &packet_vector;
+            messages[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        const int sent = sendmmsg(this->socket_id, messages, batch_size, 0);
+        if (sent > 0) sent_amount += sent;
+    }
+
+    return sent_amount;
+#else
+    std::size_t sent_amount = 0;
+    for (std::size_t i = 0; i < recipients_amount; i++)
+    {
+        if (sendto(this->socket_id, packet, packet_len, 0, reinterpret_cast<const sockaddr*>(&recipients[i].address), sizeof(sockaddr_in)) >= 0) sent_amount++;
+    }
+
+    return sent_amount;
+#endif
 }
 
-void Server::MoveCommand(char* buffer, Sender& sender, const int len)
+// ----------------------------------------------------------------------------------------------
+
+void Server::EnableMetrics(const std::string& path)
 {
-    if (len != (header_bytes_amount + cell_bytes_amount)) return;
+    this->metrics_path = path;
+    this->last_metrics_timestamp = Clock::GetNowMilliseconds();
+}
+
+void Server::CheckMetrics()
+{
+    AllocationSite allocation_site("CheckMetrics");
+
+    if (this->metrics_path.empty()) return;
+
+    const std::size_t now = Clock::GetNowMilliseconds();
+    if ((now - this->last_metrics_timestamp) < metrics_interval_seconds * 1000) return;
+
+    this->heavy_hitters.Expire(now); // The windows move only with the packets: a flood over leaves no top talkers behind.
 
-    if (this->players.find(sender) != this->players.end())
+    std::string report;
+    this->AppendMetrics(report);
+    TTTServer::WriteMetricsFile(this->metrics_path, report);
+
+    this->last_metrics_timestamp = now;
+}
+
+void Server::AppendMetrics(std::string& report) const
+{
+    TTTServer::AppendMetric(report, "ttt_players", this->players.size());
+    TTTServer::AppendMetric(report, "ttt_rooms", this->rooms.size());
+    TTTServer::AppendMetric(report, "ttt_opened_rooms", this->opened_rooms.size());
+
+    TTTServer::AppendMetric(report, "ttt_spectators", this->spectating.size());
+    TTTServer::AppendMetric(report, "ttt_pending_spectator_broadcasts", this->pending_spectator_broadcasts.size());
+
+    TTTServer::AppendMetric(report, "ttt_quick_match_waiting", this->quick_match_tickets.size());
+    this->time_to_match_us.AppendTo(report, "ttt_quick_match_time_to_match_us");
+
+    TTTServer::AppendMetric(report, "ttt_session_rebinds_total", this->rebinds_amount);
+    TTTServer::AppendMetric(report, "ttt_join_cookies_total", this->join_cookies_amount);
+    TTTServer::AppendMetric(report, "ttt_pings_total", this->pings_amount);
+    TTTServer::AppendMetric(report, "ttt_busy_poll", this->busy_poll ? 1 : 0);
+    this->move_round_trip_us.AppendTo(report, "ttt_move_round_trip_us");
+    TTTServer::AppendMetric(report, "ttt_heartbeat_interval_seconds", this->GetHeartbeatInterval());
+
+    TTTServer::AppendMetric(report, "ttt_reliable_peers", this->reliable_peers.size());
+    TTTServer::AppendMetric(report, "ttt_retransmissions_total", this->retransmissions_amount);
+    TTTServer::AppendMetric(report, "ttt_acknowledgements_total", this->acknowledgements_amount);
+    TTTServer::AppendMetric(report, "ttt_retransmission_give_ups_total", this->give_ups_amount);
+
+    TTTServer::AppendMetric(report, "ttt_socket_receive_buffer_bytes", this->receive_buffer_bytes);
+    TTTServer::AppendMetric(report, "ttt_socket_send_buffer_bytes", this->send_buffer_bytes);
+    TTTServer::AppendMetric(report, "ttt_socket_receive_drops_total", this->kernel_drops_amount);
+    this->receive_queueing_delay_us.AppendTo(report, "ttt_receive_queueing_delay_us");
+    this->service_time_us.AppendTo(report, "ttt_service_time_us");
+
+    TTTServer::AppendMetric(report, "ttt_outbound_datagrams_total", this->outbound_datagrams_amount);
+    TTTServer::AppendMetric(report, "ttt_outbound_messages_total", this->outbound_messages_amount);
+
+    this->game_lane.depth.AppendTo(report, "ttt_game_lane_depth");
+    this->game_lane.wait_us.AppendTo(report, "ttt_game_lane_wait_us");
+    this->lobby_lane.depth.AppendTo(report, "ttt_lobby_lane_depth");
+    this->lobby_lane.wait_us.AppendTo(report, "ttt_lobby_lane_wait_us");
+    TTTServer::AppendMetric(report, "ttt_lobby_lane_queued", this->lobby_lane.size);
+    TTTServer::AppendMetric(report, "ttt_lobby_lane_drops_total", this->lobby_lane.drops_amount);
+    TTTServer::AppendMetric(report, "ttt_overloaded", this->overloaded ? 1 : 0);
+    TTTServer::AppendMetric(report, "ttt_deferred_announces_total", this->deferred_announces_amount);
+
+    TTTServer::AppendMetric(report, "ttt_max_players", this->max_players);
+    TTTServer::AppendMetric(report, "ttt_max_rooms", this->max_rooms);
+    TTTServer::AppendMetric(report, "ttt_waiting_room", this->waiting_tickets.size());
+    TTTServer::AppendMetric(report, "ttt_waiting_room_admissions_total", this->admissions_amount);
+    TTTServer::AppendMetric(report, "ttt_rejected_rooms_total", this->rejected_rooms_amount);
+    this->tick_work_us.AppendTo(report, "ttt_tick_work_us");
+    TTTServer::AppendMetric(report, "ttt_tick_work_average_us", this->tick_work_average_us);
+    TTTServer::AppendMetric(report, "ttt_shedding", this->shedding ? 1 : 0);
+    TTTServer::AppendMetric(report, "ttt_shed_episodes_total", this->shed_episodes_amount);
+
+    TTTServer::AppendMetric(report, "ttt_heavy_hitter_drops_total", this->heavy_hitters.GetDropsAmount());
+    this->heavy_hitters.AppendTo(report, "ttt_top_talker_packets");
+
+    this->AppendMemoryReport(report);
+
+    if (AllocationTracker::IsEnabled())
     {
-        Player& current_player = this->players.find(sender)->second;
+        this->allocations_per_tick.AppendTo(report, "ttt_allocations_per_tick");
+        AllocationTracker::AppendReport(report, "ttt_allocations_total");
+    }
+}
 
-        int current_room_id = current_player.GetCurrentRoom().first;  
-        if (current_room_id <= 0)
+// Node containers: one heap block per entry (links and value), plus the bucket array.
+template <typename HashMap>
+static std::size_t GetHashMapMemoryUsage(const HashMap& hash_map)
+{
+    return hash_map.size() * Utility::GetHeapBlockBytes(sizeof(void*) + sizeof(typename HashMap::value_type)) + hash_map.bucket_count() * sizeof(void*);
+}
+
+template <typename Vector>
+static std::size_t GetVectorMemoryUsage(const Vector& vector)
+{
+    return vector.capacity() * sizeof(typename Vector::value_type);
+}
+
+std::size_t Server::AppendMemoryReport(std::string& report) const
+{
+    const std::pair<const char*, std::size_t> structures[] =
+    {
+        { "sessions", this->sessions.size() * sizeof(session_t) },
+        { "endpoints", GetHashMapMemoryUsage(this->players) },
+        { "session_tokens", GetVectorMemoryUsage(this->session_tokens) + GetVectorMemoryUsage(this->session_generations) + GetVectorMemoryUsage(this->reliable_sequences) },
+        { "player_registry", this->player_registry.GetMemoryUsage() },
+        { "reliable_peers", GetHashMapMemoryUsage(this->reliable_peers) },
+        { "quick_match_tickets", GetHashMapMemoryUsage(this->quick_match_tickets) },
+        { "spectating", GetHashMapMemoryUsage(this->spectating) },
+        { "rooms", GetHashMapMemoryUsage(this->rooms) },
+        { "packet_buffers", PacketBuffer::GetMemoryUsage() },
+        { "outbound_frames", GetVectorMemoryUsage(this->outbound_frames) + GetVectorMemoryUsage(this->outbound_slots) },
+        { "priority_lanes", GetVectorMemoryUsage(this->game_lane.slots) + GetVectorMemoryUsage(this->lobby_lane.slots) },
+        { "waiting_room", GetHashMapMemoryUsage(this->waiting_tickets) + this->waiting_room.size() * sizeof(waiting_entry_t) }
+    };
+
+    std::size_t total_bytes = 0;
+    for (const auto& structure : structures)
+    {
+        TTTServer::AppendMetric(report, std::string("ttt_memory_bytes{structure=\"") + structure.first + "\"}", structure.second);
+        total_bytes += structure.second;
+    }
+
+    TTTServer::AppendMetric(report, "ttt_memory_bytes_total", total_bytes);
+    TTTServer::AppendMetric(report, "ttt_memory_bytes_per_player", this->players.empty() ? 0 : total_bytes / this->players.size());
+
+    return total_bytes;
+}
+
+// ----------------------------------------------------------------------------------------------
+
+constexpr std::size_t journal_room_length = 4 + 4 + 4 + TTTGame::field_amount + 1 + 8;
+
+// Journal payloads (little endian):
+// sender --> | ipv4 address (4, network order) | port (2) |
+// player --> | sender | player_id (4) | name length (1) | name | room_id (4) | is_owner (1) | session token (8) | next reliable sequence (1) |
+// reliable sequence --> | player_id (4) | next reliable sequence (1) |
+// room   --> | room_id (4) | owner player_id (4) | challenger player_id (4, 0 = none) | field symbols (9) | turn symbol (1) | ended challenge timestamp (8) |
+
+static void AppendName(std::string& payload, const std::string_view name)
+{
+    const std::size_t name_length = std::min<std::size_t>(name.size(), 0xFF);
+    payload.push_back(static_cast<char>(name_length));
+    payload.append(name.data(), name_length);
+}
+
+static std::size_t ReadName(const char* payload, const std::size_t payload_length, std::string& name)
+{
+    if (payload_length < 1) return 0;
+
+    const std::size_t name_length = static_cast<unsigned char>(payload[0]);
+    if (payload_length < 1 + name_length) return 0;
+
+    name.assign(&payload[1], name_length);
+    return 1 + name_length;
+}
+
+static void AppendSender(std::string& payload, const Server::Sender& sender)
+{
+    const std::uint32_t address = sender.GetAddress();
+    payload.append(reinterpret_cast<const char*>(&address), 4);
+    Utility::AppendLittleEndian(payload, sender.GetPort(), 2);
+}
+
+static std::size_t ReadSender(const char* payload, const std::size_t payload_length, Server::Sender& sender)
+{
+    if (payload_length < 6) return 0;
+
+    std::uint32_t address;
+    std::memcpy(&address, payload, 4);
+
+    sender.SetAddress(address);
+    sender.SetterPort(static_cast<int>(Utility::ReadLittleEndian(&payload[4], 2)));
+    return 6;
+}
+
+static void AppendPlayer(std::string& payload, const Server::Sender& sender, const Player& player, const std::uint64_t session_token, const std::uint32_t next_sequence)
+{
+    AppendSender(payload, sender);
+    Utility::AppendLittleEndian(payload, player.GetPlayerID(), 4);
+    AppendName(payload, player.GetName());
+    Utility::AppendLittleEndian(payload, static_cast<std::uint32_t>(player.GetCurrentRoom().first), 4);
+    payload.push_back(player.GetCurrentRoom().second ? 1 : 0);
+    Utility::AppendLittleEndian(payload, session_token, 8);
+    payload.push_back(static_cast<char>(next_sequence));
+}
+
+static void AppendRoom(std::string& payload, const Room& room)
+{
+    Utility::AppendLittleEndian(payload, static_cast<std::uint32_t>(room.GetRoomID()), 4);
+    Utility::AppendLittleEndian(payload, room.GetOwner(), 4);
+    Utility::AppendLittleEndian(payload, room.GetChallenger(), 4);
+    payload.append(room.GetFieldSymbols());
+    payload.push_back(room.GetTurnSymbol());
+    Utility::AppendLittleEndian(payload, room.GetEndedChallengeTimestamp(), 8);
+}
+
+void Server::JournalPlayer(const Sender& sender, const Player& player)
+{
+    if (!this->IsJournaling()) return;
+
+    std::string payload;
+    const session_t* session = this->GetSession(player.GetPlayerID());
+    AppendPlayer(payload, sender, player, this->session_tokens[player.GetPlayerID()], session ? this->GetReliableSequence(*session) : 1);
+    this->Journal(JournalRecordType::PLAYER_UPSERT, payload);
+}
+
+void Server::JournalPlayerRemoval(const Sender& sender)
+{
+    if (!this->IsJournaling()) return;
+
+    std::string payload;
+    AppendSender(payload, sender);
+    this->Journal(JournalRecordType::PLAYER_REMOVE, payload);
+}
+
+void Server::JournalRoom(const Room& room)
+{
+    if (!this->IsJournaling()) return;
+
+    std::string payload;
+    AppendRoom(payload, room);
+    this->Journal(JournalRecordType::ROOM_UPSERT, payload);
+}
+
+void Server::JournalRoomRemoval(const int room_id)
+{
+    if (!this->IsJournaling()) return;
+
+    std::string payload;
+    Utility::AppendLittleEndian(payload, static_cast<std::uint32_t>(room_id), 4);
+    this->Journal(JournalRecordType::ROOM_REMOVE, payload);
+}
+
+void Server::JournalReliableSequence(const Sender& sender, const std::uint32_t next_sequence)
+{
+    if (!this->IsJournaling()) return;
+
+    const session_t* session = this->FindSession(sender);
+    if (!session) return;
+
+    std::string payload;
+    Utility::AppendLittleEndian(payload, session->second.GetPlayerID(), 4);
+    payload.push_back(static_cast<char>(next_sequence));
+    this->Journal(JournalRecordType::PLAYER_SEQUENCE, payload);
+}
+
+bool Server::IsJournaling() const
+{
+    return this->journal || this->handoff_connection >= 0;
+}
+
+void Server::Journal(const JournalRecordType type, const std::string& payload)
+{
+    if (this->journal) this->journal->Append(type, payload);
+
+    // Delta record --> | type (1) | payload length (4) | payload |
+    if (this->handoff_connection >= 0)
+    {
+        this->handoff_delta.push_back(static_cast<char>(type));
+        Utility::AppendLittleEndian(this->handoff_delta, payload.size(), 4);
+        this->handoff_delta.append(payload);
+    }
+}
+
+void Server::ApplyJournalRecord(const JournalRecordType type, const char* payload, const std::size_t payload_length)
+{
+    Sender sender;
+    std::size_t offset = 0;
+
+    switch (type)
+    {
+        case JournalRecordType::PLAYER_UPSERT:
         {
-            std::cout << "Player [" << sender.GetIpAddress() << ":" << sender.GetPort() << "] \"" << current_player.GetName() << "\" is not in a room!\n"; 
-            return;
-        }   
+            std::string name;
+            std::uint32_t player_id;
+            std::size_t read = ReadSender(payload, payload_length, sender);
+            if (!read) return;
+            offset += read;
+
+            if (payload_length < offset + 4) return;
+            player_id = static_cast<std::uint32_t>(Utility::ReadLittleEndian(&payload[offset], 4));
+            offset += 4;
+
+            read = ReadName(&payload[offset], payload_length - offset, name);
+            if (!read || player_id == 0 || payload_length < offset + read + 5 + 8) return;
+            offset += read;
+
+            std::pair<int, bool> room_info = { static_cast<int>(static_cast<std::uint32_t>(Utility::ReadLittleEndian(&payload[offset], 4))), payload[offset + 4] != 0 };
+            const std::uint64_t session_token = Utility::ReadLittleEndian(&payload[offset + 5], 8);
+
+            // The liveness restarts from the recovery time: clients get the usual timeouts to show up again.
+            // A known sender with a different ID gives the old one back.
+            auto known_player = this->players.find(sender);
+            if (known_player != this->players.end() && known_player->second != player_id) this->RemoveSession(known_player->second);
+            this->player_registry.Acquire(player_id);
+
+            // Clients keep using their tokens across a recovery or a hot restart.
+            if (player_id >= this->session_tokens.size())
+            {
+                this->session_tokens.resize(player_id + 1, 0);
+                this->session_generations.resize(player_id + 1, 0);
+            }
+            this->session_tokens[player_id] = session_token;
+            this->session_generations[player_id] = static_cast<std::uint8_t>(session_token >> 24);
 
-        char cell_bytes = buffer[header_bytes_amount];
-        const std::uint32_t cell = cell_bytes - '0';
+            // Records written before the sequence number was journaled start from 1, as a new session.
+            const std::uint32_t next_sequence = payload_length > offset + 5 + 8 ? static_cast<unsigned char>(payload[offset + 5 + 8]) : 1;
+            this->RestoreReliableSequence(player_id, next_sequence);
 
-        Room& room = this->rooms[current_room_id];    
-        if (!room.Move(current_player, cell))
+            Player player(player_id, name);
+            player.SetCurrentRoom(room_info);
+            this->AddPlayer(sender, player);
+            break;
+        }
+        case JournalRecordType::PLAYER_REMOVE:
         {
-            std::cout << "Player \"" << current_player.GetName() << "\" did an invalid move!\n";
-            return;
-        }   
+            if (ReadSender(payload, payload_length, sender)) this->ReleaseSender(sender);
+            break;
+        }
+        case JournalRecordType::ROOM_UPSERT:
+        {
+            if (payload_length != journal_room_length) return;
+            const int room_id = static_cast<int>(static_cast<std::uint32_t>(Utility::ReadLittleEndian(payload, 4)));
+            const std::uint32_t owner_id = static_cast<std::uint32_t>(Utility::ReadLittleEndian(&payload[4], 4));
+            const std::uint32_t challenger_id = static_cast<std::uint32_t>(Utility::ReadLittleEndian(&payload[8], 4));
+            offset += 12;
+
+            const std::string field_symbols(&payload[offset], TTTGame::field_amount);
+            const char turn_symbol = payload[offset + TTTGame::field_amount];
+            const std::size_t ended_challenge_timestamp = Utility::ReadLittleEndian(&payload[offset + TTTGame::field_amount + 1], 8);
+
+            // The seats are the IDs restored by the player records.
+            Room room(room_id, owner_id);
+            room.SetChallenger(challenger_id);
+
+            room.Restore(field_symbols, turn_symbol);
+            // Monotonic timestamps are only comparable on the same boot: never in the future.
+            room.SetEndedChallengeTimestamp(std::min<std::size_t>(ended_challenge_timestamp, Clock::GetNowMilliseconds()));
+            this->rooms[room_id] = room;
+
+            if (static_cast<std::size_t>(room_id) >= this->room_counter) this->room_counter = room_id + 1;
+            break;
+        }
+        case JournalRecordType::ROOM_REMOVE:
+        {
+            if (payload_length < 4) return;
+            this->rooms.erase(static_cast<int>(static_cast<std::uint32_t>(Utility::ReadLittleEndian(payload, 4))));
+            break;
+        }
+        case JournalRecordType::PLAYER_SEQUENCE:
+        {
+            if (payload_length < 5) return;
 
-        current_player.SetLastPacketTimeStamp(); 
+            const std::uint32_t player_id = static_cast<std::uint32_t>(Utility::ReadLittleEndian(payload, 4));
+            if (this->GetSession(player_id)) this->RestoreReliableSequence(player_id, static_cast<unsigned char>(payload[4]));
+            break;
+        }
+    }
+}
 
-        UpdateField(room);  
+// Snapshot state --> | room_counter (8) | players amount (8) | player ... | rooms amount (8) | room ... |
+bool Server::BuildSnapshotSlice(snapshot_build_t& build, const std::size_t slots_amount) const
+{
+    const std::size_t last_slot = std::min(this->sessions.size(), build.next_slot + slots_amount);
+    for (; build.next_slot < last_slot; build.next_slot++)
+    {
+        const session_t& session = this->sessions[build.next_slot];
+        if (session.second.GetPlayerID() == 0) continue; // Free slot.
 
-        if (room.GetWinner())
+        AppendPlayer(build.players, session.first, session.second, this->session_tokens[session.second.GetPlayerID()], this->GetReliableSequence(session));
+        build.players_amount++;
+
+        // Every room has its owner in a slot: it's copied along, without walking "rooms" across ticks.
+        const std::pair<int, bool> current_room = session.second.GetCurrentRoom();
+        if (!current_room.second) continue;
+
+        const auto room = this->rooms.find(current_room.first);
+        if (room == this->rooms.end()) continue;
+
+        AppendRoom(build.rooms, room->second);
+        build.rooms_amount++;
+    }
+
+    return build.next_slot >= this->sessions.size();
+}
+
+std::string Server::FinishSnapshot(snapshot_build_t& build) const
+{
+    std::string snapshot;
+    snapshot.reserve(24 + build.players.size() + build.rooms.size());
+
+    Utility::AppendLittleEndian(snapshot, this->room_counter, 8);
+    Utility::AppendLittleEndian(snapshot, build.players_amount, 8);
+    snapshot.append(build.players);
+    Utility::AppendLittleEndian(snapshot, build.rooms_amount, 8);
+    snapshot.append(build.rooms);
+
+    build = snapshot_build_t();
+    return snapshot;
+}
+
+std::string Server::BuildSnapshot() const
+{
+    snapshot_build_t build;
+    build.players.reserve(this->players.size() * 40);
+    build.rooms.reserve(this->rooms.size() * journal_room_length);
+
+    this->BuildSnapshotSlice(build, this->sessions.size());
+    return this->FinishSnapshot(build);
+}
+
+void Server::LoadSnapshot(const char* snapshot, const std::size_t snapshot_length)
+{
+    if (snapshot_length < 16) return;
+
+    this->room_counter = Utility::ReadLittleEndian(snapshot, 8);
+    const std::size_t players_amount = Utility::ReadLittleEndian(&snapshot[8], 8);
+    std::size_t offset = 16;
+
+    this->players.reserve(players_amount);
+
+    // Each entry is decoded exactly as the matching WAL record: only its length has to be found here.
+    for (std::size_t i = 0; i < players_amount; i++)
+    {
+        if (snapshot_length < offset + 11) return;
+
+        const std::size_t name_length = static_cast<unsigned char>(snapshot[offset + 10]);
+        const std::size_t player_length = 6 + 4 + 1 + name_length + 5 + 8 + 1;
+        if (snapshot_length < offset + player_length) return;
+
+        this->ApplyJournalRecord(JournalRecordType::PLAYER_UPSERT, &snapshot[offset], player_length);
+        offset += player_length;
+    }
+
+    if (snapshot_length < offset + 8) return;
+    const std::size_t rooms_amount = Utility::ReadLittleEndian(&snapshot[offset], 8);
+    offset += 8;
+
+    for (std::size_t i = 0; i < rooms_amount; i++)
+    {
+        if (snapshot_length < offset + journal_room_length) return;
+
+        this->ApplyJournalRecord(JournalRecordType::ROOM_UPSERT, &snapshot[offset], journal_room_length);
+        offset += journal_room_length;
+    }
+}
+
+void Server::EnableJournal(const std::string& path_prefix, const bool recover)
+{
+    try
+    {
+        const std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+
+        this->journal_path = path_prefix;
+        this->journal = std::make_unique<StateJournal>(path_prefix);
+        this->snapshot_build = snapshot_build_t();
+
+        // The state is already in memory (e.g. received by a hot restart): the snapshot below replaces the files.
+        if (!recover)
         {
-            std::cout << "Player \"" << room.GetWinner()->GetName() << "\" WON!\n";
-            room.SetEndedChallengeTimestamp(Utility::GetNowTime());
+            this->journal->Open();
+            this->journal->RequestSnapshot(this->BuildSnapshot(), this->journal->GetLastLsn());
+            this->last_snapshot_timestamp = Clock::GetNowMilliseconds();
+            return;
         }
-        else if (room.IsDraw())
+
+        this->journal->Recover(
+            [this](const char* snapshot, const std::size_t snapshot_length) { this->LoadSnapshot(snapshot, snapshot_length); },
+            [this](const JournalRecordType type, const char* payload, const std::size_t payload_length) { this->ApplyJournalRecord(type, payload, payload_length); });
+
+        // Opened rooms are not journaled: they are exactly the rooms still waiting for a challenger.
+        this->opened_rooms.clear();
+        for (const auto& room : this->rooms)
         {
-            std::cout << "The game is ended in DRAW!\n";
-            room.SetEndedChallengeTimestamp(Utility::GetNowTime());
+            if (room.second.IsDoorOpen()) this->opened_rooms.insert(room.first);
         }
 
+        const double elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+        std::cout << "Recovered " << this->players.size() << " players and " << this->rooms.size() << " rooms in " << elapsed_ms << " ms\n";
+
+        this->journal->Open();
+
+        // A fresh snapshot right away keeps the next recovery independent from the replayed WAL.
+        this->journal->RequestSnapshot(this->BuildSnapshot(), this->journal->GetLastLsn());
+        this->last_snapshot_timestamp = Clock::GetNowMilliseconds();
+    }
+    catch (const NetworkException& exception)
+    {
+        this->journal.reset();
+        std::cout << exception.what() << "\n";
+    }
+}
+
+void Server::CheckSnapshot()
+{
+    AllocationSite allocation_site("CheckSnapshot");
+
+    if (!this->journal) return;
+
+    if (!this->snapshot_build.active)
+    {
+        const std::size_t now = Clock::GetNowMilliseconds();
+        if ((now - this->last_snapshot_timestamp) < snapshot_interval_seconds * 1000 && this->journal->GetRecordsSinceSnapshot() < snapshot_records_threshold) return;
+
+        this->snapshot_build.active = true;
+        this->snapshot_build.lsn = this->journal->GetLastLsn();
+        this->last_snapshot_timestamp = now;
+    }
+
+    if (!this->BuildSnapshotSlice(this->snapshot_build, snapshot_slots_per_tick)) return;
+
+    const std::uint64_t snapshot_lsn = this->snapshot_build.lsn;
+    this->journal->RequestSnapshot(this->FinishSnapshot(this->snapshot_build), snapshot_lsn);
+}
+
+// ----------------------------------------------------------------------------------------------
+
+void Server::EnableHotRestart(const std::string& path)
+{
+    if (!this->hot_restart.Listen(path))
+    {
+        std::cout << "Unable to listen for hot restarts on \"" << path << "\"!\n";
         return;
-    }   
+    }
 
-    std::cout << "Unknown player from [" << sender.GetIpAddress() << ":" << sender.GetPort() << "]\n";
+    std::cout << "Waiting for hot restarts on \"" << path << "\"\n";
 }
 
-void Server::QuitCommand(char* buffer, Sender& sender, const int len)
+void Server::CheckHandoff()
 {
-    if (this->players.count(sender) > 0)
+    AllocationSite allocation_site("CheckHandoff");
+
+    if (this->handoff_connection < 0)
     {
-        this->RemovePlayer(sender);
+        this->handoff_connection = this->hot_restart.AcceptPending();
+        if (this->handoff_connection < 0) return;
+
+        // First step: the new process gets the socket and the whole state, while this one keeps serving.
+        std::cout << "New process found: sending " << this->players.size() << " players and " << this->rooms.size() << " rooms...\n";
+        this->handoff_delta.clear();
+
+        if (!this->hot_restart.SendState(this->handoff_connection, this->socket_id, this->BuildSnapshot()))
+        {
+            std::cout << "Hot restart failed, still serving!\n";
+            HotRestart::CloseConnection(this->handoff_connection);
+            this->handoff_connection = -1;
+        }
+
         return;
-    }   
+    }
 
-    std::cout << "Unknown player from [" << sender.GetIpAddress() << ":" << sender.GetPort() << "]\n";
+    if (!this->hot_restart.IsReady(this->handoff_connection)) return;
+
+    // Second step: from here on no packet is read, the datagrams wait into the socket queue for the new process.
+    const std::uint64_t paused_at_ns = HotRestart::GetMonotonicNanoseconds();
+
+    // The new process owns the journal files from now on: pending records are committed first.
+    this->journal.reset();
+
+    const bool handed_off = this->hot_restart.SendDelta(this->handoff_connection, this->handoff_delta, paused_at_ns);
+
+    HotRestart::CloseConnection(this->handoff_connection);
+    this->handoff_connection = -1;
+    this->handoff_delta.clear();
+
+    if (!handed_off)
+    {
+        std::cout << "Hot restart failed, still serving!\n";
+        if (!this->journal_path.empty()) this->EnableJournal(this->journal_path, false);
+        return;
+    }
+
+    std::cout << "Hot restart completed, bye!\n";
+    this->hot_restart.Close();
+    this->running = false;
+}
+
+void Server::ApplyHandoffDelta(const std::string& delta)
+{
+    std::size_t offset = 0;
+    while (offset + 5 <= delta.size())
+    {
+        const JournalRecordType type = static_cast<JournalRecordType>(delta[offset]);
+        const std::size_t payload_length = Utility::ReadLittleEndian(&delta[offset + 1], 4);
+        if (offset + 5 + payload_length > delta.size()) return;
+
+        this->ApplyJournalRecord(type, &delta[offset + 5], payload_length);
+        offset += 5 + payload_length;
+    }
+}
+
+bool Server::TakeOver(const std::string& path)
+{
+    std::string snapshot, delta;
+    std::uint64_t paused_at_ns = 0;
+
+    const int connection = HotRestart::ReceiveState(path, this->socket_id, snapshot);
+    if (connection < 0)
+    {
+        std::cout << "Unable to take over from \"" << path << "\"!\n";
+        return false;
+    }
+
+    // The slow part (rebuilding every container) happens while the old process is still serving.
+    this->LoadSnapshot(snapshot.data(), snapshot.size());
+
+    const bool completed = HotRestart::ReceiveDelta(connection, delta, paused_at_ns);
+    HotRestart::CloseConnection(connection);
+
+    if (!completed)
+    {
+        // The old process keeps serving on its own copy of the socket.
+        HotRestart::CloseConnection(this->socket_id);
+        this->socket_id = -1;
+
+        std::cout << "Unable to take over from \"" << path << "\"!\n";
+        return false;
+    }
+
+    this->ApplyHandoffDelta(delta);
+
+    for (const auto& room : this->rooms)
+    {
+        if (room.second.IsDoorOpen()) this->opened_rooms.insert(room.first);
+    }
+
+    const double pause_ms = (HotRestart::GetMonotonicNanoseconds() - paused_at_ns) / 1000000.0;
+    std::cout << "Took over " << this->players.size() << " players and " << this->rooms.size() << " rooms (" << delta.size() << " delta bytes), serving paused for " << pause_ms << " ms\n";
+
+    return true;
 }
 
 // ----------------------------------------------------------------------------------------------
 
+
+// ----------------------------------------------------------------------------------------------
+
+// Usage: tictactoe_server.exe [--capture <path>] [--journal <path_prefix>] [--hot-restart <unix_socket_path> [--take-over]]
+//                             [--metrics <path>] [--seed <number>] [--receive-buffer <bytes>] [--send-buffer <bytes>] [--busy-poll <cpu>] [--join-cookies]
+//                             [--flood-threshold <packets_per_second>] [--max-players <number>] [--max-rooms <number>] [--shed-latency-ms <ms>]
+//                             | [--replay <path> [--realtime]]
+// Built with "TTT_TESTS" the server has no "main": the tests under "tests/" bring their own.
+#ifndef TTT_TESTS
 int main(int argc, char** argv)
 {
+    std::string capture_path, replay_path, journal_path, hot_restart_path, metrics_path;
+    bool at_recorded_speed = false;
+    bool take_over = false;
+    int receive_buffer_bytes = 0, send_buffer_bytes = 0; // 0 --> "default_socket_buffer_bytes".
+    int busy_poll_cpu = -1;
+    bool join_cookies = false;
+    std::uint32_t flood_threshold = 0; // 0 --> sources only counted.
+    std::size_t max_players = 0, max_rooms = 0, shed_latency_ms = 0; // 0 --> no limit.
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string argument(argv[i]);
+
+        if (argument == "--capture" && i + 1 < argc) capture_path = argv[++i];
+        else if (argument == "--replay" && i + 1 < argc) replay_path = argv[++i];
+        else if (argument == "--journal" && i + 1 < argc) journal_path = argv[++i];
+        else if (argument == "--hot-restart" && i + 1 < argc) hot_restart_path = argv[++i];
+        else if (argument == "--metrics" && i + 1 < argc) metrics_path = argv[++i];
+        else if (argument == "--seed" && i + 1 < argc) Random::SetSeed(std::stoull(argv[++i]));
+        else if (argument == "--receive-buffer" && i + 1 < argc) receive_buffer_bytes = std::stoi(argv[++i]);
+        else if (argument == "--send-buffer" && i + 1 < argc) send_buffer_bytes = std::stoi(argv[++i]);
+        else if (argument == "--busy-poll" && i + 1 < argc) busy_poll_cpu = std::stoi(argv[++i]);
+        else if (argument == "--join-cookies") join_cookies = true;
+        else if (argument == "--flood-threshold" && i + 1 < argc) flood_threshold = static_cast<std::uint32_t>(std::stoul(argv[++i]));
+        else if (argument == "--max-players" && i + 1 < argc) max_players = std::stoull(argv[++i]);
+        else if (argument == "--max-rooms" && i + 1 < argc) max_rooms = std::stoull(argv[++i]);
+        else if (argument == "--shed-latency-ms" && i + 1 < argc) shed_latency_ms = std::stoull(argv[++i]);
+        else if (argument == "--take-over") take_over = true;
+        else if (argument == "--realtime") at_recorded_speed = true;
+    }
+
+    if (receive_buffer_bytes <= 0) receive_buffer_bytes = TTTServer::default_socket_buffer_bytes;
+    if (send_buffer_bytes <= 0) send_buffer_bytes = TTTServer::default_socket_buffer_bytes;
+
+    if (!replay_path.empty())
+    {
+        Server server("127.0.0.1", 9999, 1000, false); // Cookies and keys come from the capture.
+        server.SetCapacity(max_players, max_rooms, 0); // Same limits, same waiters; shedding depends on the live load.
+        server.Replay(replay_path, at_recorded_speed);
+
+        return EXIT_SUCCESS;
+    }
+
+    if (take_over && !hot_restart_path.empty())
+    {
+        // No socket of its own: the bound one comes from the running server.
+        Server server("127.0.0.1", 9999, 1000, false);
+        if (!server.TakeOver(hot_restart_path)) return EXIT_FAILURE;
+        if (join_cookies) server.EnableJoinCookies(); // New key: a cookie in flight is answered with a new one.
+        if (flood_threshold > 0) server.EnableFloodDefense(flood_threshold);
+        server.SetCapacity(max_players, max_rooms, shed_latency_ms);
+        server.SetSocketBuffers(receive_buffer_bytes, send_buffer_bytes); // Also reads back the sizes of the inherited socket.
+
+        if (!journal_path.empty()) server.EnableJournal(journal_path, false);
+        if (!capture_path.empty()) server.StartCapture(capture_path);
+        if (!metrics_path.empty()) server.EnableMetrics(metrics_path);
+        server.EnableHotRestart(hot_restart_path);
+        if (busy_poll_cpu >= 0) server.EnableBusyPoll(busy_poll_cpu);
+        server.Run();
+
+        return EXIT_SUCCESS;
+    }
+
     Server server = {};
+    if (join_cookies) server.EnableJoinCookies();
+    if (flood_threshold > 0) server.EnableFloodDefense(flood_threshold);
+    server.SetCapacity(max_players, max_rooms, shed_latency_ms);
+    if (receive_buffer_bytes != TTTServer::default_socket_buffer_bytes || send_buffer_bytes != TTTServer::default_socket_buffer_bytes) server.SetSocketBuffers(receive_buffer_bytes, send_buffer_bytes);
+    if (!journal_path.empty()) server.EnableJournal(journal_path);
+    if (!capture_path.empty()) server.StartCapture(capture_path);
+    if (!metrics_path.empty()) server.EnableMetrics(metrics_path);
+    if (!hot_restart_path.empty()) server.EnableHotRestart(hot_restart_path);
+    if (busy_poll_cpu >= 0) server.EnableBusyPoll(busy_poll_cpu); // Last: the threads created above keep their own CPUs.
     server.Run();
 
     return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
+#endif
\ No newline at end of file
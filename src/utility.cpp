@@ -2,16 +2,118 @@
 
 namespace Utility
 {
-    std::size_t GetNowTime()
+    std::string GetParsedRoomIDLength(const std::string& room_id_str, const std::size_t room_id_len)
     {
-        auto now = std::chrono::system_clock::now();
-        auto duration = std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch());
-        return duration.count();
+        return (room_id_len < two_figures_factor) ? std::to_string(room_id_str.length()) + "?" : std::to_string(room_id_str.length());
     }
 
-    std::string GetParsedRoomIDLength(const std::string& room_id_str, const std::size_t room_id_len)
+    int ParseRoomID(const char* buffer, const int len, const std::size_t header_bytes_amount, const std::size_t room_id_len)
     {
-        return (room_id_len < two_figures_factor) ? std::to_string(room_id_str.length()) + "?" : std::to_string(room_id_str.length());
+        if (len < 0 || static_cast<std::size_t>(len) < header_bytes_amount + room_id_len) return -1;
+
+        std::size_t room_id_length = 0;
+        for (std::size_t i = 0; i < room_id_len; i++)
+        {
+            const char figure = buffer[header_bytes_amount + i];
+            if (figure < '0' || figure > '9') break;
+
+            room_id_length = room_id_length * 10 + (figure - '0');
+        }
+
+        const std::size_t room_id_offset = header_bytes_amount + room_id_len;
+        if (room_id_length == 0 || room_id_length > 9 || room_id_offset + room_id_length > static_cast<std::size_t>(len)) return -1;
+
+        int room_id = 0;
+        for (std::size_t i = 0; i < room_id_length; i++)
+        {
+            const char figure = buffer[room_id_offset + i];
+            if (figure < '0' || figure > '9') return -1;
+
+            room_id = room_id * 10 + (figure - '0');
+        }
+
+        return room_id;
+    }
+
+    std::string EncodeHeader(const std::uint32_t rid, const std::uint32_t command)
+    {
+        return { static_cast<char>('0' + rid), static_cast<char>('0' + command) };
+    }
+
+    void WriteLittleEndian(char* destination, std::uint64_t value, const std::size_t bytes_amount)
+    {
+        for (std::size_t i = 0; i < bytes_amount; i++)
+        {
+            destination[i] = static_cast<char>(value & 0xFF);
+            value >>= 8;
+        }
+    }
+
+    void AppendLittleEndian(std::string& destination, const std::uint64_t value, const std::size_t bytes_amount)
+    {
+        char bytes[sizeof(std::uint64_t)];
+        WriteLittleEndian(bytes, value, bytes_amount);
+        destination.append(bytes, bytes_amount);
+    }
+
+    std::uint64_t ReadLittleEndian(const char* source, const std::size_t bytes_amount)
+    {
+        std::uint64_t value = 0;
+        for (std::size_t i = bytes_amount; i > 0; i--)
+        {
+            value = (value << 8) | static_cast<unsigned char>(source[i - 1]);
+        }
+
+        return value;
+    }
+
+    static std::uint64_t RotateLeft(const std::uint64_t value, const int bits)
+    {
+        return (value << bits) | (value >> (64 - bits));
+    }
+
+    static void SipRound(std::uint64_t& v0, std::uint64_t& v1, std::uint64_t& v2, std::uint64_t& v3)
+    {
+        v0 += v1; v1 = RotateLeft(v1, 13); v1 ^= v0; v0 = RotateLeft(v0, 32);
+        v2 += v3; v3 = RotateLeft(v3, 16); v3 ^= v2;
+        v0 += v3; v3 = RotateLeft(v3, 21); v3 ^= v0;
+        v2 += v1; v1 = RotateLeft(v1, 17); v1 ^= v2; v2 = RotateLeft(v2, 32);
+    }
+
+    std::uint64_t SipHash(const std::uint64_t key_0, const std::uint64_t key_1, const char* data, const std::size_t len)
+    {
+        std::uint64_t v0 = 0x736F6D6570736575ull ^ key_0;
+        std::uint64_t v1 = 0x646F72616E646F6Dull ^ key_1;
+        std::uint64_t v2 = 0x6C7967656E657261ull ^ key_0;
+        std::uint64_t v3 = 0x7465646279746573ull ^ key_1;
+
+        // 8 bytes words (little endian), then the last one padded with the length into its top byte.
+        const std::size_t words_end = len & ~static_cast<std::size_t>(7);
+        for (std::size_t offset = 0; offset < words_end; offset += 8)
+        {
+            const std::uint64_t word = ReadLittleEndian(&data[offset], 8);
+            v3 ^= word;
+            SipRound(v0, v1, v2, v3);
+            SipRound(v0, v1, v2, v3);
+            v0 ^= word;
+        }
+
+        const std::uint64_t last_word = ReadLittleEndian(&data[words_end], len - words_end) | (static_cast<std::uint64_t>(len & 0xFF) << 56);
+        v3 ^= last_word;
+        SipRound(v0, v1, v2, v3);
+        SipRound(v0, v1, v2, v3);
+        v0 ^= last_word;
+
+        v2 ^= 0xFF;
+        for (int i = 0; i < 4; i++) SipRound(v0, v1, v2, v3);
+
+        return v0 ^ v1 ^ v2 ^ v3;
+    }
+
+    std::size_t GetHeapBlockBytes(const std::size_t requested_bytes)
+    {
+        const std::size_t block_bytes = (requested_bytes + sizeof(std::size_t) + 15) & ~static_cast<std::size_t>(15);
+        return block_bytes < 32 ? 32 : block_bytes;
     }
 
     const char* NetworkException::what() const noexcept
@@ -0,0 +1,90 @@
+#include <sequence_window.hpp>
+
+#include <iostream>
+
+// Reliable sequences of one peer, as numbered by "ReliablePeer::Track" on the server (1..63, one counter per peer).
+static constexpr std::uint32_t sequence_space = 63;
+static constexpr std::uint32_t start_game = 6;
+static constexpr std::uint32_t update_field = 7;
+static constexpr std::uint32_t reset_client = 8;
+
+static int failures = 0;
+
+static void Expect(const bool condition, const char* description)
+{
+    if (condition) return;
+
+    std::cout << "FAILED: " << description << "\n";
+    failures++;
+}
+
+static std::uint32_t Next(const std::uint32_t sequence)
+{
+    return (sequence % sequence_space) + 1;
+}
+
+int main()
+{
+    // A rare command more than half the space later (here: START_GAME after 40 updates) is still fresh.
+    {
+        SequenceWindow window(sequence_space);
+        std::uint32_t sequence = 1;
+
+        Expect(!window.IsStale(start_game, sequence), "first START_GAME is fresh");
+        for (int i = 0; i < 40; i++)
+        {
+            sequence = Next(sequence);
+            Expect(!window.IsStale(update_field, sequence), "UPDATE_FIELD is fresh");
+        }
+
+        sequence = Next(sequence);
+        Expect(!window.IsStale(start_game, sequence), "START_GAME past the half window is fresh");
+        Expect(window.IsStale(start_game, sequence), "duplicate START_GAME is stale");
+        Expect(window.IsStale(update_field, 30), "late UPDATE_FIELD 30 is stale");
+    }
+
+    // Many wraps of the counter: the commands keep interleaving without false stales.
+    {
+        SequenceWindow window(sequence_space);
+        std::uint32_t sequence = 0;
+
+        for (int i = 0; i < 1000; i++)
+        {
+            sequence = Next(sequence);
+            const std::uint32_t command = i % 100 == 0 ? reset_client : (i % 50 == 0 ? start_game : update_field);
+            Expect(!window.IsStale(command, sequence), "interleaved sequence is fresh");
+            Expect(window.IsStale(command, sequence), "interleaved duplicate is stale");
+        }
+    }
+
+    // A retransmission overtaken by a newer packet of another command is still applied, once.
+    {
+        SequenceWindow window(sequence_space);
+
+        Expect(!window.IsStale(update_field, 62), "UPDATE_FIELD 62 is fresh");
+        Expect(!window.IsStale(update_field, 2), "UPDATE_FIELD 2 (wrapped) is fresh");
+        Expect(!window.IsStale(start_game, 1), "late START_GAME 1 is fresh");
+        Expect(window.IsStale(start_game, 1), "late START_GAME 1 again is stale");
+        Expect(window.IsStale(update_field, 63), "late UPDATE_FIELD 63 behind UPDATE_FIELD 2 is stale");
+    }
+
+    // A new session restarts from sequence 1.
+    {
+        SequenceWindow window(sequence_space);
+
+        Expect(!window.IsStale(update_field, 30), "UPDATE_FIELD 30 is fresh");
+        window.Reset();
+        Expect(!window.IsStale(update_field, 1), "UPDATE_FIELD 1 after the reset is fresh");
+    }
+
+    // Unreliable packets are never stale.
+    {
+        SequenceWindow window(sequence_space);
+
+        Expect(!window.IsStale(update_field, 0), "unreliable packet");
+        Expect(!window.IsStale(update_field, 0), "unreliable packet again");
+    }
+
+    std::cout << (failures == 0 ? "sequence_window_test: OK\n" : "sequence_window_test: FAILED\n");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,71 @@
+#include <tictactoe_server.hpp>
+
+#include <iostream>
+#include <fstream>
+#include <string>
+
+#ifdef __linux__
+    #include <unistd.h>
+#endif
+
+// Loads idle lobby players (1M by default, or the amount given on the command line), prints the memory report
+// and checks the bytes per session against "session_memory_budget_bytes".
+
+static std::size_t GetResidentBytes()
+{
+#ifdef __linux__
+    std::ifstream statm("/proc/self/statm");
+    std::size_t total_pages = 0, resident_pages = 0;
+    statm >> total_pages >> resident_pages;
+
+    return resident_pages * static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+#else
+    return 0; // Only the accounted bytes are checked.
+#endif
+}
+
+namespace TTTServer
+{
+    class ServerTest
+    {
+    public:
+        static bool CheckSessionMemory(Server& server, const std::size_t players_amount)
+        {
+            const std::size_t resident_bytes_before = GetResidentBytes();
+
+            // The state left by a JOIN (no socket: the SESSION packet goes nowhere), from distinct endpoints.
+            for (std::size_t i = 0; i < players_amount; i++)
+            {
+                Server::Sender sender;
+                sender.SetAddress(htonl(0x0A000000 + static_cast<std::uint32_t>(i >> 16)));
+                sender.SetterPort(static_cast<int>(i & 0xFFFF));
+
+                Player player(server.player_registry.Acquire(), "player" + std::to_string(i));
+                server.AddPlayer(sender, player);
+                server.IssueSessionToken(player.GetPlayerID());
+            }
+
+            std::string report;
+            const std::size_t accounted_bytes = server.AppendMemoryReport(report);
+            const std::size_t resident_bytes = GetResidentBytes() - resident_bytes_before;
+            std::cout << report;
+
+            const std::size_t accounted_per_player = players_amount ? accounted_bytes / players_amount : 0;
+            const std::size_t resident_per_player = players_amount ? resident_bytes / players_amount : 0;
+            std::cout << players_amount << " idle players: " << accounted_per_player << " bytes/session accounted, " << resident_per_player << " bytes/session resident (budget: " << session_memory_budget_bytes << ")\n";
+
+            return accounted_per_player <= session_memory_budget_bytes && resident_per_player <= session_memory_budget_bytes;
+        }
+    };
+}
+
+int main(int argc, char** argv)
+{
+    const std::size_t players_amount = argc > 1 ? std::stoull(argv[1]) : 1000000;
+
+    Server server("127.0.0.1", 9999, 1000, false);
+    const bool passed = TTTServer::ServerTest::CheckSessionMemory(server, players_amount);
+
+    std::cout << (passed ? "session_memory_test: OK\n" : "session_memory_test: FAILED\n");
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,132 @@
+#include <tictactoe_server.hpp>
+
+#include <iostream>
+#include <cstring>
+#include <string>
+
+#ifndef TTT_TRACK_ALLOCATIONS
+    #error "Build the allocation test with TTT_TRACK_ALLOCATIONS (the allocation counter)"
+#endif
+
+// Built with "TTT_TRACK_ALLOCATIONS": plays games (50 by default, or the amount given on the command line) in a room
+// of two simulated clients and a spectator, and checks that after the first one (the warm-up) no heap allocation is made.
+
+namespace TTTServer
+{
+    class ServerTest
+    {
+    public:
+        static bool CheckSteadyStateAllocations(Server& server, const std::size_t games_amount)
+        {
+            Clock::EnableVirtualTime(Clock::Update());
+
+            // Owner, challenger and a spectator on the loopback (nobody listens there): their packets are written straight into the dispatch buffer.
+            constexpr int clients_amount = 3;
+            sockaddr_in inputs[clients_amount];
+            Server::Sender senders[clients_amount];
+            std::uint64_t tokens[clients_amount] = { 0, 0, 0 };
+            char buffer[buffer_size];
+
+            auto dispatch = [&](const int client, const std::uint32_t rid, const Command command, const char* payload, const std::size_t payload_len)
+            {
+                buffer[0] = static_cast<char>('0' + rid);
+                buffer[1] = static_cast<char>('0' + command);
+                std::size_t len = header_bytes_amount;
+
+                if (command != Command::JOIN)
+                {
+                    Utility::WriteLittleEndian(&buffer[len], tokens[client], session_token_bytes_amount);
+                    len += session_token_bytes_amount;
+                }
+
+                if (payload_len > 0) std::memcpy(&buffer[len], payload, payload_len);
+                server.Dispatch(buffer, static_cast<int>(len + payload_len), inputs[client]);
+            };
+
+            // The latest sequence number sent to "client": acknowledged as a real client would do.
+            auto last_sequence = [&](const int client) -> std::uint32_t
+            {
+                auto reliable_peer = server.reliable_peers.find(senders[client]);
+                if (reliable_peer == server.reliable_peers.end()) return 0;
+
+                const std::uint32_t next_sequence = reliable_peer->second.GetNextSequence();
+                return next_sequence > 1 ? next_sequence - 1 : reliable_sequence_space;
+            };
+
+            // Names longer than the small string buffer of "std::string": copying them would allocate.
+            const char player_names[clients_amount][player_name_bytes_amount] = { "owner_of_the_room", "challenger_of_room", "spectator_of_room" };
+            for (int client = 0; client < clients_amount; client++)
+            {
+                std::memset(&inputs[client], 0, sizeof(sockaddr_in));
+                inputs[client].sin_family = AF_INET;
+                inputs[client].sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+                inputs[client].sin_port = htons(static_cast<std::uint16_t>(1 + client));
+
+                senders[client].SetAddress(inputs[client].sin_addr.s_addr);
+                senders[client].SetterPort(1 + client);
+
+                dispatch(client, 0, Command::JOIN, player_names[client], player_name_bytes_amount);
+
+                const Server::session_t* session = server.FindSession(senders[client]);
+                if (!session) return false;
+                tokens[client] = server.session_tokens[session->second.GetPlayerID()];
+            }
+
+            dispatch(0, 0, Command::CREATE_ROOM, nullptr, 0);
+
+            const std::string room_id_str(std::to_string(server.room_counter - 1));
+            const std::string challenge_info(Utility::GetParsedRoomIDLength(room_id_str, room_id_str.length()) + room_id_str);
+            dispatch(1, 0, Command::CHALLENGE, challenge_info.c_str(), challenge_info.size());
+            dispatch(2, 0, Command::SPECTATE, challenge_info.c_str(), challenge_info.size());
+
+            for (std::size_t game = 0; game < games_amount; game++)
+            {
+                if (game == 1) AllocationTracker::Reset(); // End of the warm-up.
+
+                for (char cell = '0'; cell <= '8'; cell++)
+                {
+                    // Both clients try every cell: only the one on turn is accepted.
+                    for (int client = 0; client < 2; client++)
+                    {
+                        dispatch(client, 0, Command::MOVE, &cell, 1);
+                        dispatch(client, last_sequence(client), Command::ACK, nullptr, 0);
+                        dispatch(client, 0, Command::PING, nullptr, 0);
+                    }
+                    dispatch(2, 0, Command::PING, nullptr, 0);
+
+                    server.CheckEndedChallenges();
+                    server.CheckDeadPeers();
+                    server.FlushSpectatorBroadcasts();
+                    server.CheckRetransmissions();
+                    server.FlushOutbound();
+                }
+
+                // The ended game is reset after "reset_field_time".
+                Clock::Advance(reset_field_time * 1000 + 1);
+                server.CheckEndedChallenges();
+                server.FlushOutbound();
+            }
+
+            const std::uint64_t allocations_amount = AllocationTracker::GetAllocationsAmount();
+            Clock::DisableVirtualTime();
+
+            std::string report;
+            AllocationTracker::AppendReport(report, "ttt_allocations_total"); // Its own allocations are charged to "other".
+            std::cout << report << (games_amount > 0 ? games_amount - 1 : 0) << " games after the warm-up: " << allocations_amount << " heap allocations\n";
+
+            return allocations_amount == 0;
+        }
+    };
+}
+
+int main(int argc, char** argv)
+{
+    const std::size_t games_amount = argc > 1 ? std::stoull(argv[1]) : 50;
+
+    // Any free port: the room packets really go through the socket (and the reliable delivery).
+    Server server("127.0.0.1", 0);
+    const bool passed = TTTServer::ServerTest::CheckSteadyStateAllocations(server, games_amount);
+
+    std::cout << (passed ? "steady_state_allocation_test: OK\n" : "steady_state_allocation_test: FAILED\n");
+    return passed ? 0 : 1;
+}